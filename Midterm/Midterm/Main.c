@@ -4,12 +4,36 @@
 #include <stdint.h>
 #include <windows.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "vector.h"
 #include "mesh.h"
+#include "instance.h"
+#include "cull.h"
+#include "arena.h"
+#include "raster.h"
+#include "command.h"
+#include "layer.h"
+#include "depth.h"
+#include "hud.h"
+#include "offline.h"
+#include "delta.h"
+#include "scene.h"
+#include "bench.h"
+#include "recorder.h"
 
 #define FPS 30
 #define FRAME_TARGET_TIME (1000/FPS)
 
+//Scene time the timeline ends at, and the size --offline renders it at
+#define TIMELINE_LENGTH 105000
+#define OFFLINE_WIDTH 1920
+#define OFFLINE_HEIGHT 1080
+
+//Nodes in the --scene-bench graph, and updates timed per dirty share
+#define BENCH_SCENE_NODES 100000
+#define BENCH_SCENE_UPDATES 100
+
 // Global Variables
 SDL_Texture* textures = NULL;
 SDL_Window* window = NULL;
@@ -17,62 +41,94 @@ SDL_Renderer* renderer = NULL;
 SDL_Texture* texture = NULL;
 uint32_t* color_buffer = NULL;
 
+//Rendered into when frame_format is not ARGB, expanded into color_buffer to present
+void* reduced_buffer = NULL;
+palette_t frame_palette;
+pixel_format_t frame_format = PIXEL_ARGB8888; //F2 cycles
+
+//Hashes of the color_buffer tiles already on the texture
+tile_tracker_t screen_tiles;
+
 bool is_running = false;
 
 int window_width;
 int window_height;
-int rect_x = 0;
-int snowman_x = 0;
-int poly_y = 0;
 int scaling_factor = 1000;
 int previous_frame_time = 0;
 
-triangle_t triangles_to_render[N_MESH_FACES];
-triangle_t triangles2_to_render[N_MESH2_FACES];
-triangle_t triangles3_to_render[N_MESH3_FACES];
+//What the live loop records each frame into
+recorder_t frame_recorder;
+
+//Parts are placed relative to their parent, roots are moved by record_scene.
+//build_scene_graph() adds them in this order, so the same ids hold in every recorder's graph
+enum {
+    SNOWMAN_NODE,
+    SNOWMAN_HEAD_NODE,
+    SNOWMAN_BODY_NODE,
+    SNOWMAN_LEFT_EYE_NODE,
+    SNOWMAN_RIGHT_EYE_NODE,
+    SNOWMAN_NOSE_NODE,
+    SNOWMAN_MOUTH_NODE,
+    SNOWMAN_HAT_NODE,
+    TREE_NODE,
+    TREE_STAR_NODE,
+    N_SCENE_NODES
+};
+#define TREE_TRUNK_HEIGHT 245
+#define TREE_TWINKLE_TIME 500 //ms the tree keeps its colors, so its layer is reused in between
+bool antialiased_lines = false; //F1 toggles
+bool show_hud = false; //F3 toggles
 
 vec3_t camera_position = { .x = 0, .y = 0, .z = -5 };
 
-vec3_t square_pyramid_scaling = { .x = 1, .y = 1, .z = 1 };
-vec3_t square_pyramid_rotation = { .x = 0, .y = 0, .z = 0 };
-vec3_t square_pyramid_translation = { .x = 0, .y = 0, .z = 0 };
-
-vec3_t octahedron_scaling = { .x = 1, .y = 3, .z = 1 }; 
-vec3_t octahedron_rotation = { .x = 0, .y = 0, .z = 0 };
-vec3_t octahedron_translation = { .x = 0, .y = 0, .z = 0 };
-
-vec3_t triangular_pyramid_scaling = { .x = 1, .y = 1, .z = 1 };
-vec3_t triangular_pyramid_rotation = { .x = 0, .y = 0, .z = 0 };
-vec3_t triangular_pyramid_translation = { .x = 0, .y = 0, .z = 0 };
-
-vec3_t octahedron2_scaling = { .x = 1, .y = 1, .z = 1 };
-vec3_t octahedron2_rotation = { .x = 0, .y = 0, .z = 0 };
-vec3_t octahedron2_translation = { .x = 0, .y = 0, .z = 0 };
+//From the upper left, behind the camera
+light_t scene_light = { .direction = {.x = 0.36f, .y = 0.48f, .z = 0.8f }, .ambient = 0.25f };
 
 //Function Declarations
 bool initialize_windowing_system();
 void clean_up();
 void run_render_pipeline();
+void upload_changed_tiles(void);
 void process_keyboard_input(void);
 void setup_memory_buffers(void);
-void clear_color_buffer(uint32_t color);
-void draw_pixel(int x, int y, uint32_t color);
-void draw_line(int x0, int y0, int x1, int y1, uint32_t color);
-void draw_rect(int x, int y, int width, int height, uint32_t color);
-void draw_circle(int x, int y, int radius, uint32_t color);
-void draw_triangle(int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color);
-void draw_polygon(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3, int x4, int y4, int x5, int y5, uint32_t color);
-void draw_cloud();
-void draw_snow();
-void draw_snowman();
-void draw_tree(int x, int y, int trunk_width, int trunk_height, uint32_t color);
-void draw_star(int x, int y, int size, uint32_t color, float angle);
-void project_square_pyramid();
-void project_octahedron();
-void project_triangular_pyramid();
-void project_octahedron2();
-uint32_t generate_random_color();
-vec2_t perspective_project_point(vec3_t point_3d);
+void prepare_meshes(void);
+bool build_scene_graph(scene_graph_t* graph);
+transform_t translation_transform(float x, float y);
+void clear_color_buffer(recorder_t* recorder, uint32_t color);
+void draw_pixel(recorder_t* recorder, int x, int y, uint32_t color);
+void draw_line(recorder_t* recorder, int x0, int y0, int x1, int y1, uint32_t color);
+void draw_rect(recorder_t* recorder, int x, int y, int width, int height, uint32_t color);
+void draw_ellipse(recorder_t* recorder, float x, float y, float radius_x, float radius_y, bool filled, uint32_t color);
+void draw_circle(recorder_t* recorder, float x, float y, float radius, uint32_t color);
+void draw_filled_circle(recorder_t* recorder, float x, float y, float radius, uint32_t color);
+void draw_triangle(recorder_t* recorder, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color);
+void draw_filled_triangle(recorder_t* recorder, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color);
+void draw_polygons(recorder_t* recorder, const polygon_t* polygons, int n_polygons, polygon_mode_t mode);
+void draw_hexagons(recorder_t* recorder, int poly_y);
+void draw_cloud(recorder_t* recorder, int rect_x);
+void draw_snow(recorder_t* recorder);
+void draw_snowman(recorder_t* recorder);
+void draw_tree(recorder_t* recorder, int x, int y, int trunk_width, int trunk_height, uint32_t color);
+void draw_star(recorder_t* recorder, int x, int y, int size, uint32_t color, float angle);
+int project_square_pyramid(recorder_t* recorder, transform_t placement, triangle_t** triangles);
+int project_octahedron(recorder_t* recorder, transform_t placement, triangle_t** triangles);
+int project_triangular_pyramid(recorder_t* recorder, transform_t placement, triangle_t** triangles);
+int project_octahedron2(recorder_t* recorder, transform_t placement, triangle_t** triangles);
+projection_t scene_projection();
+int project_into_frame_arena(recorder_t* recorder, const mesh_t* mesh, const instance_t* instances, int n_instances, const light_t* light, triangle_t** triangles);
+void draw_mesh_triangle(recorder_t* recorder, triangle_t triangle, uint32_t color);
+void draw_depth_face(recorder_t* recorder, const triangle_t* triangle);
+void outline_with_random_colors(recorder_t* recorder, triangle_t* triangles, int n_triangles);
+void draw_mesh_instances(recorder_t* recorder, const triangle_t* triangles, int n_triangles);
+void draw_depth_sorted_faces(recorder_t* recorder);
+uint32_t generate_random_color(recorder_t* recorder);
+float frames_since(uint32_t elapsed_time, uint32_t moment);
+float breathing_drift(uint32_t elapsed_time, uint32_t moment, float amplitude);
+int scrolled_position(float distance, int extent);
+void record_scene(recorder_t* recorder, uint32_t elapsed_time);
+int run_offline_benchmark(void);
+int run_offline_export(const char* path);
+int run_scene_benchmark(void);
 
 bool initialize_windowing_system() {
 
@@ -108,16 +164,75 @@ bool initialize_windowing_system() {
 
 void clean_up() {
     free(color_buffer);
+    free(reduced_buffer);
+    free_recorder(&frame_recorder);
+    free_layers();
+    free_hud();
+    free_tile_tracker(&screen_tiles);
+    free_instance_workers();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
 void run_render_pipeline() {
+    void* pixels = frame_format == PIXEL_ARGB8888 ? (void*)color_buffer : reduced_buffer;
+    framebuffer_t framebuffer = { pixels, window_width, window_height, antialiased_lines, frame_format, &frame_palette };
+
+    uint64_t stage = SDL_GetPerformanceCounter();
+
+    //Cached layers go between the clear and the foreground commands
+    raster_clear(&framebuffer, frame_recorder.commands.clear_color);
+    stage = hud_time_stage(HUD_STAGE_CLEAR, stage);
+    composite_layers(&framebuffer, frame_recorder.layer_commands, frame_recorder.layer_used);
+    draw_command_buffer(&frame_recorder.commands, &framebuffer);
+    stage = hud_time_stage(HUD_STAGE_DRAW, stage);
+
+    if (framebuffer.format != PIXEL_ARGB8888) {
+        raster_expand_to_argb(&framebuffer, color_buffer);
+    }
+
+    //Over the finished scene, its own cost is left out of every stage
+    if (show_hud) {
+        framebuffer_t overlay = { color_buffer, window_width, window_height };
+        draw_hud(&overlay, framebuffer.pixels_written, last_skipped_fraction(&screen_tiles));
+        stage = SDL_GetPerformanceCounter();
+    }
 
-    SDL_UpdateTexture(texture, NULL, color_buffer, (int)(window_width * sizeof(uint32_t)));
+    upload_changed_tiles();
+    stage = hud_time_stage(HUD_STAGE_UPLOAD, stage);
     SDL_RenderCopy(renderer, texture, NULL, NULL);
     SDL_RenderPresent(renderer);
+    hud_time_stage(HUD_STAGE_PRESENT, stage);
+}
+
+//Runs of changed tiles along a tile row go up in one call, a fully changed frame in one
+void upload_changed_tiles(void) {
+    int pitch = (int)(window_width * sizeof(uint32_t));
+    if (track_frame_tiles(&screen_tiles, color_buffer) == screen_tiles.tiles_x * screen_tiles.tiles_y) {
+        SDL_UpdateTexture(texture, NULL, color_buffer, pitch);
+        return;
+    }
+
+    for (int ty = 0; ty < screen_tiles.tiles_y; ty++) {
+        const bool* changed = &screen_tiles.changed[ty * screen_tiles.tiles_x];
+        for (int tx = 0; tx < screen_tiles.tiles_x; ) {
+            if (!changed[tx]) {
+                tx++;
+                continue;
+            }
+            int run_end = tx + 1;
+            while (run_end < screen_tiles.tiles_x && changed[run_end]) {
+                run_end++;
+            }
+
+            SDL_Rect rect = { tx * DELTA_TILE_SIZE, ty * DELTA_TILE_SIZE, (run_end - tx) * DELTA_TILE_SIZE, DELTA_TILE_SIZE };
+            rect.w = rect.x + rect.w < window_width ? rect.w : window_width - rect.x;
+            rect.h = rect.y + rect.h < window_height ? rect.h : window_height - rect.y;
+            SDL_UpdateTexture(texture, &rect, color_buffer + rect.y * window_width + rect.x, pitch);
+            tx = run_end;
+        }
+    }
 }
 
 void process_keyboard_input(void) {
@@ -134,6 +249,12 @@ void process_keyboard_input(void) {
     case SDL_KEYDOWN:
         if (event.key.keysym.sym == SDLK_ESCAPE)
             is_running = false;
+        if (event.key.keysym.sym == SDLK_F1)
+            antialiased_lines = !antialiased_lines;
+        if (event.key.keysym.sym == SDLK_F2)
+            frame_format = (frame_format + 1) % (PIXEL_INDEXED8 + 1);
+        if (event.key.keysym.sym == SDLK_F3)
+            show_hud = !show_hud;
         break;
 
     }
@@ -142,397 +263,426 @@ void process_keyboard_input(void) {
 void setup_memory_buffers(void) {
 
     color_buffer = (uint32_t*)malloc(window_width * window_height * sizeof(uint32_t));
+    reduced_buffer = malloc(window_width * window_height * sizeof(uint16_t));
 
     texture = SDL_CreateTexture(renderer,
         SDL_PIXELFORMAT_ARGB8888,
         SDL_TEXTUREACCESS_STREAMING,
         window_width,
         window_height);
+
+    init_recorder(&frame_recorder);
+    init_instance_workers();
+    init_layers(window_width, window_height);
+    init_hud(1000.0 / FPS); //FRAME_TARGET_TIME is rounded down to whole ms
+    init_tile_tracker(&screen_tiles, window_width, window_height);
+    prepare_meshes();
+    build_scene_graph(&frame_recorder.scene);
 }
 
-void clear_color_buffer(uint32_t color) {
-    for (int y = 0; y < window_height; y++) {
-        for (int x = 0; x < window_width; x++) {
-            color_buffer[(y * window_width) + x] = color;
-        }
-    }
+transform_t translation_transform(float x, float y) {
+    transform_t transform = identity_transform();
+    transform.translation.x = x;
+    transform.translation.y = y;
+    return transform;
 }
 
-uint32_t generate_random_color() {
-    uint8_t r = rand() % 256; 
-    uint8_t g = rand() % 256; 
-    uint8_t b = rand() % 256;
+//Screen space, y down
+bool build_scene_graph(scene_graph_t* graph) {
+    //Stops at the first node that does not fit, so no parent is ever missing
+    bool built = add_scene_node(graph, -1, identity_transform()) == SNOWMAN_NODE
+        && add_scene_node(graph, SNOWMAN_NODE, translation_transform(0, 200)) == SNOWMAN_HEAD_NODE
+        && add_scene_node(graph, SNOWMAN_NODE, translation_transform(0, 500)) == SNOWMAN_BODY_NODE
+        && add_scene_node(graph, SNOWMAN_HEAD_NODE, translation_transform(-25, -20)) == SNOWMAN_LEFT_EYE_NODE
+        && add_scene_node(graph, SNOWMAN_HEAD_NODE, translation_transform(25, -20)) == SNOWMAN_RIGHT_EYE_NODE
+        && add_scene_node(graph, SNOWMAN_HEAD_NODE, translation_transform(0, 0)) == SNOWMAN_NOSE_NODE
+        && add_scene_node(graph, SNOWMAN_HEAD_NODE, translation_transform(0, 40)) == SNOWMAN_MOUTH_NODE
+        && add_scene_node(graph, SNOWMAN_HEAD_NODE, translation_transform(0, -130)) == SNOWMAN_HAT_NODE
+
+        //On the tip of the top leaf
+        && add_scene_node(graph, -1, identity_transform()) == TREE_NODE
+        && add_scene_node(graph, TREE_NODE, translation_transform(0, -TREE_TRUNK_HEIGHT)) == TREE_STAR_NODE;
+    update_scene_graph(graph);
+    return built;
+}
+
+void prepare_meshes(void) {
+    compute_mesh_bounds(&square_pyramid_mesh);
+    compute_mesh_bounds(&octahedron_mesh);
+    compute_mesh_bounds(&triangular_pyramid_mesh);
+    compute_mesh_normals(&square_pyramid_mesh);
+    compute_mesh_normals(&octahedron_mesh);
+    compute_mesh_normals(&triangular_pyramid_mesh);
+}
+
+//Whatever was recorded before a clear would be painted over, so it is dropped
+void clear_color_buffer(recorder_t* recorder, uint32_t color) {
+    clear_recorder(recorder, color);
+}
+
+uint32_t generate_random_color(recorder_t* recorder) {
+    uint8_t r = next_random(recorder) % 256; 
+    uint8_t g = next_random(recorder) % 256; 
+    uint8_t b = next_random(recorder) % 256;
 
     return (r << 16) | (g << 8) | b;
 }
 
-void draw_pixel(int x, int y, uint32_t color) {
-    if (x < window_width && y < window_height) {
-        color_buffer[(y * window_width) + x] = color;
+void draw_pixel(recorder_t* recorder, int x, int y, uint32_t color) {
+    record_pixel(recorder->active, x, y, color);
+}
+
+void draw_line(recorder_t* recorder, int x0, int y0, int x1, int y1, uint32_t color) {
+    if (cull_screen_primitive(&recorder->cull_stats, x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1, x0 > x1 ? x0 : x1, y0 > y1 ? y0 : y1, window_width, window_height)) {
+        return;
     }
+
+    record_line(recorder->active, x0, y0, x1, y1, color);
 }
 
-void draw_line(int x0, int y0, int x1, int y1, uint32_t color) {
-    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
-    int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
-    int err = dx + dy, e2;
+void draw_rect(recorder_t* recorder, int x, int y, int width, int height, uint32_t color) {
+    if (cull_screen_object(&recorder->cull_stats, x, y, x + width, y + height, window_width, window_height)) {
+        return;
+    }
 
-    for (;;) {
-        draw_pixel(x0, y0, color);
-        if (x0 == x1 && y0 == y1) {
-            break;
-        }
-        e2 = 2 * err;
+    //Top, bottom, left, right
+    uint32_t side_colors[4];
+    for (int i = 0; i < 4; i++) {
+        side_colors[i] = generate_random_color(recorder);
+    }
+    record_rect(recorder->active, x, y, width, height, side_colors);
+}
 
-        if (e2 >= dy) {
-            err += dy;
-            x0 += sx;
-        }
-        if (e2 <= dx) {
-            err += dx;
-            y0 += sy;
-        }
+void draw_ellipse(recorder_t* recorder, float x, float y, float radius_x, float radius_y, bool filled, uint32_t color) {
+    if (cull_screen_object(&recorder->cull_stats, (int)(x - radius_x) - 1, (int)(y - radius_y) - 1, (int)(x + radius_x) + 1, (int)(y + radius_y) + 1, window_width, window_height)) {
+        return;
     }
+
+    record_ellipse(recorder->active, x, y, radius_x, radius_y, filled, color);
 }
 
-void draw_rect(int x, int y, int width, int height, uint32_t color) {
-    //Top
-    draw_line(x, y, x + width, y, generate_random_color());
-    //Bottom
-    draw_line(x, y + height, x + width, y + height, generate_random_color());
-    //Left
-    draw_line(x, y, x, y + height, generate_random_color());
-    //Right
-    draw_line(x + width, y, x + width, y + height, generate_random_color());
+void draw_circle(recorder_t* recorder, float x, float y, float radius, uint32_t color) {
+    draw_ellipse(recorder, x, y, radius, radius, false, color);
 }
 
-void draw_circle(int x, int y, int radius, uint32_t color) {
-    int current_x = radius;
-    int current_y = 0;
-    int err = 0;
-    
-    //Octant
-    while (current_x >= current_y) {
-        draw_pixel(x + current_x, y + current_y, color); 
-        draw_pixel(x + current_y, y + current_x, color); 
-        draw_pixel(x - current_y, y + current_x, color); 
-        draw_pixel(x - current_x, y + current_y, color); 
-        draw_pixel(x - current_x, y - current_y, color); 
-        draw_pixel(x - current_y, y - current_x, color); 
-        draw_pixel(x + current_y, y - current_x, color); 
-        draw_pixel(x + current_x, y - current_y, color); 
-
-        //Error
-        if (err <= 0) {
-            err += 2 * current_y + 1;
-            current_y++;
-        }
+void draw_filled_circle(recorder_t* recorder, float x, float y, float radius, uint32_t color) {
+    draw_ellipse(recorder, x, y, radius, radius, true, color);
+}
 
-        if (err > 0) {
-            err -= 2 * current_x + 1;
-            current_x--;
-        }
+void draw_triangle(recorder_t* recorder, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color) {
+    int min_x = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+    int min_y = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+    int max_x = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+    int max_y = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+    if (cull_screen_primitive(&recorder->cull_stats, min_x, min_y, max_x, max_y, window_width, window_height)) {
+        return;
     }
+
+    record_triangle(recorder->active, x0, y0, x1, y1, x2, y2, color);
 }
 
-void draw_triangle(int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color) {
-    draw_line(x0, y0, x1, y1, color);
-    draw_line(x1, y1, x2, y2, color);
-    draw_line(x2, y2, x0, y0, color);
+void draw_filled_triangle(recorder_t* recorder, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color) {
+    int min_x = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+    int min_y = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+    int max_x = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+    int max_y = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+    if (cull_screen_primitive(&recorder->cull_stats, min_x, min_y, max_x, max_y, window_width, window_height)) {
+        return;
+    }
+
+    record_filled_triangle(recorder->active, x0, y0, x1, y1, x2, y2, color);
 }
 
-void draw_polygon(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3, int x4, int y4, int x5, int y5, uint32_t color) {
-    y0 += poly_y;
-    y1 += poly_y;
-    y2 += poly_y;
-    y3 += poly_y;
-    y4 += poly_y;
-    y5 += poly_y;
+//Culls each polygon, then records the survivors in one batch
+void draw_polygons(recorder_t* recorder, const polygon_t* polygons, int n_polygons, polygon_mode_t mode) {
+    polygon_t* visible = ARENA_ALLOC_ARRAY(&recorder->arena, polygon_t, n_polygons);
+    if (!visible) {
+        return;
+    }
 
-    draw_line(x0, y0, x1, y1, color);
-    draw_line(x1, y1, x2, y2, color);
-    draw_line(x2, y2, x3, y3, color);
-    draw_line(x3, y3, x4, y4, color);
-    draw_line(x4, y4, x5, y5, color);
-    draw_line(x5, y5, x0, y0, color);
+    int n_visible = 0;
+    for (int p = 0; p < n_polygons; p++) {
+        const polygon_t* polygon = &polygons[p];
+        if (polygon->n_points <= 0) {
+            continue;
+        }
 
-    //Vertical loop for translation
-    poly_y += 5;
-    if (poly_y >= window_height) {
-        poly_y = -70;
+        float min_x = polygon->points[0].x, min_y = polygon->points[0].y;
+        float max_x = min_x, max_y = min_y;
+        for (int i = 1; i < polygon->n_points; i++) {
+            min_x = polygon->points[i].x < min_x ? polygon->points[i].x : min_x;
+            min_y = polygon->points[i].y < min_y ? polygon->points[i].y : min_y;
+            max_x = polygon->points[i].x > max_x ? polygon->points[i].x : max_x;
+            max_y = polygon->points[i].y > max_y ? polygon->points[i].y : max_y;
+        }
+
+        if (!cull_screen_object(&recorder->cull_stats, (int)(min_x + polygon->offset.x), (int)(min_y + polygon->offset.y),
+            (int)(max_x + polygon->offset.x), (int)(max_y + polygon->offset.y), window_width, window_height)) {
+            visible[n_visible++] = *polygon;
+        }
     }
+
+    record_polygons(recorder->active, visible, n_visible, mode);
 }
 
-void draw_cloud() {
+//Hexagon outline relative to its top left corner, and its mirror for the right side of the screen
+vec2_t hexagon_points[6] = { {0, 0}, {50, 50}, {100, 0}, {100, 100}, {50, 150}, {0, 100} };
+vec2_t mirrored_hexagon_points[6] = { {0, 0}, {-50, 50}, {-100, 0}, {-100, 100}, {-50, 150}, {0, 100} };
+
+#define N_HEXAGONS 10
+
+//Two diagonals of hexagons scrolling down together
+void draw_hexagons(recorder_t* recorder, int poly_y) {
+    polygon_t hexagons[N_HEXAGONS];
+    for (int i = 0; i < N_HEXAGONS; i++) {
+        int step = i % (N_HEXAGONS / 2);
+        bool mirrored = i >= N_HEXAGONS / 2;
+        hexagons[i].points = mirrored ? mirrored_hexagon_points : hexagon_points;
+        hexagons[i].n_points = 6;
+        hexagons[i].offset.x = mirrored ? window_width - 100 - 200 * step : 100 + 200 * step;
+        hexagons[i].offset.y = 100 + 100 * step + poly_y;
+        hexagons[i].color = generate_random_color(recorder);
+    }
+    draw_polygons(recorder, hexagons, N_HEXAGONS, POLYGON_OUTLINE);
+}
+
+void draw_cloud(recorder_t* recorder, int rect_x) {
     //left to right
-    draw_rect(rect_x, 100, 500, 200, generate_random_color());
-    draw_rect(rect_x + 800, 120, 500, 200, generate_random_color());
-    draw_rect(rect_x + 1500, 126, 500, 200, generate_random_color());
-    draw_rect(rect_x + 2100, 100, 500, 200, generate_random_color());
+    draw_rect(recorder, rect_x, 100, 500, 200, generate_random_color(recorder));
+    draw_rect(recorder, rect_x + 800, 120, 500, 200, generate_random_color(recorder));
+    draw_rect(recorder, rect_x + 1500, 126, 500, 200, generate_random_color(recorder));
+    draw_rect(recorder, rect_x + 2100, 100, 500, 200, generate_random_color(recorder));
 
     //right to left
-    draw_rect(100 - rect_x, 100, 500, 200, generate_random_color());
-    draw_rect(800 - rect_x, 130, 500, 200, generate_random_color());
-    draw_rect(1500 - rect_x, 150, 500, 200, generate_random_color());
-    draw_rect(2100 - rect_x, 100, 500, 200, generate_random_color());
-
-    //Horizontal right loop for translation
-    rect_x += 5;
-    if (rect_x >= window_width) {
-        rect_x = -70;
-    }
+    draw_rect(recorder, 100 - rect_x, 100, 500, 200, generate_random_color(recorder));
+    draw_rect(recorder, 800 - rect_x, 130, 500, 200, generate_random_color(recorder));
+    draw_rect(recorder, 1500 - rect_x, 150, 500, 200, generate_random_color(recorder));
+    draw_rect(recorder, 2100 - rect_x, 100, 500, 200, generate_random_color(recorder));
 }
-void draw_snow() {
+void draw_snow(recorder_t* recorder) {
     //Generate random # snow
-    int num_snow = rand() % 51 + 50;
+    int num_snow = next_random(recorder) % 51 + 50;
 
     for (int i = 0; i < num_snow; i++) {
-        int x = rand() % window_width;
-        int y = rand() % (window_height - 350) + 350; //Below the clouds
+        int x = next_random(recorder) % window_width;
+        int y = next_random(recorder) % (window_height - 350) + 350; //Below the clouds
 
-        draw_pixel(x, y, 0xFFFFFF);
+        draw_pixel(recorder, x, y, 0xFFFFFF);
     }
 }
 
-void draw_snowman() {
-    //head
-    draw_circle(snowman_x, (window_height / 2) + 200, 100, 0xFFFFFF);
-
-    //body
-    draw_circle(snowman_x, (window_height / 2) + 500, 200, 0xFFFFFF);
-
-    //eyes
-    draw_pixel(snowman_x - 25, (window_height / 2) + 180, 0xFF0000); // Left eye
-    draw_pixel(snowman_x + 25, (window_height / 2) + 180, 0xFF0000); // Right eye
-
-    //nose
-    draw_triangle(snowman_x - 5, (window_height / 2) + 200,
-                  snowman_x + 5, (window_height / 2) + 200,
-                  snowman_x, (window_height / 2) + 210, 0xFFA500);
-
-    //mouth
-    draw_triangle(snowman_x - 20, (window_height / 2) + 240,
-                  snowman_x, (window_height / 2) + 250,
-                  snowman_x + 20, (window_height / 2) + 240, 0xe4c1ad);
-
-    //hat
-    draw_rect(snowman_x - 70, (window_height / 2) + 70, 140, 30, 0x00FF00);
-    draw_rect(snowman_x - 35, (window_height / 2) - 70, 70, 140, 0x00FF00);
-
-    //Horizontal right loop for translation
-    snowman_x += 5;
-    if (snowman_x >= window_width) {
-        snowman_x = -70;
+void draw_snowman(recorder_t* recorder) {
+    //Hat top to body bottom
+    vec3_t root = node_position(&recorder->scene, SNOWMAN_NODE);
+    if (!cull_screen_object(&recorder->cull_stats, (int)root.x - 200, (int)root.y - 70, (int)root.x + 200, (int)root.y + 700, window_width, window_height)) {
+        //head
+        vec3_t head = node_position(&recorder->scene, SNOWMAN_HEAD_NODE);
+        draw_filled_circle(recorder, head.x, head.y, 100, 0xFFFFFF);
+
+        //body
+        vec3_t body = node_position(&recorder->scene, SNOWMAN_BODY_NODE);
+        draw_filled_circle(recorder, body.x, body.y, 200, 0xFFFFFF);
+
+        //eyes
+        vec3_t left_eye = node_position(&recorder->scene, SNOWMAN_LEFT_EYE_NODE);
+        vec3_t right_eye = node_position(&recorder->scene, SNOWMAN_RIGHT_EYE_NODE);
+        draw_pixel(recorder, (int)left_eye.x, (int)left_eye.y, 0xFF0000);
+        draw_pixel(recorder, (int)right_eye.x, (int)right_eye.y, 0xFF0000);
+
+        //nose
+        vec3_t nose = node_position(&recorder->scene, SNOWMAN_NOSE_NODE);
+        draw_triangle(recorder, (int)nose.x - 5, (int)nose.y,
+                      (int)nose.x + 5, (int)nose.y,
+                      (int)nose.x, (int)nose.y + 10, 0xFFA500);
+
+        //mouth
+        vec3_t mouth = node_position(&recorder->scene, SNOWMAN_MOUTH_NODE);
+        draw_triangle(recorder, (int)mouth.x - 20, (int)mouth.y,
+                      (int)mouth.x, (int)mouth.y + 10,
+                      (int)mouth.x + 20, (int)mouth.y, 0xe4c1ad);
+
+        //hat, brim then crown
+        vec3_t hat = node_position(&recorder->scene, SNOWMAN_HAT_NODE);
+        draw_rect(recorder, (int)hat.x - 70, (int)hat.y, 140, 30, 0x00FF00);
+        draw_rect(recorder, (int)hat.x - 35, (int)hat.y - 140, 70, 140, 0x00FF00);
     }
 }
 
-void draw_tree(int x, int y, int trunk_width, int trunk_height, uint32_t color) {
+void draw_tree(recorder_t* recorder, int x, int y, int trunk_width, int trunk_height, uint32_t color) {
+    int half_width = trunk_width / 2 > 90 ? trunk_width / 2 : 90;
+    int bottom = y - 100 + trunk_height > y - trunk_height + 140 ? y - 100 + trunk_height : y - trunk_height + 140;
+    if (cull_screen_object(&recorder->cull_stats, x - half_width, y - trunk_height, x + half_width, bottom, window_width, window_height)) {
+        return;
+    }
+
     //trunk
-    draw_rect(x - trunk_width / 2, y - 100, trunk_width, trunk_height, color);
+    draw_rect(recorder, x - trunk_width / 2, y - 100, trunk_width, trunk_height, color);
 
     //Leaf
     int lx = x;
     int ly = y - trunk_height;
 
     //Top
-    draw_triangle(lx, ly, lx - 50, ly + 50, lx + 50, ly + 50, generate_random_color());
+    draw_triangle(recorder, lx, ly, lx - 50, ly + 50, lx + 50, ly + 50, generate_random_color(recorder));
 
     //Middle
-    draw_triangle(lx, ly + 40, lx - 70, ly + 90, lx + 70, ly + 90, generate_random_color());
+    draw_triangle(recorder, lx, ly + 40, lx - 70, ly + 90, lx + 70, ly + 90, generate_random_color(recorder));
 
     //Bottom
-    draw_triangle(lx, ly + 80, lx - 90, ly + 140, lx + 90, ly + 140, generate_random_color());
+    draw_triangle(recorder, lx, ly + 80, lx - 90, ly + 140, lx + 90, ly + 140, generate_random_color(recorder));
 }
 
 
-void draw_star(int x, int y, int size, uint32_t color, float angle) {
-    //triangles vertices 4 triangle by 3*2 points
-    float vertices[4][6] = {
-        {x, y - size, x - size / 2, y + size / 2, x + size / 2, y + size / 2}, // Top triangle
-        {x, y + size, x - size / 2, y - size / 2, x + size / 2, y - size / 2}, // Bottom triangle
-        {x - size, y, x + size / 2, y - size / 2, x + size / 2, y + size / 2}, // Left triangle
-        {x + size, y, x - size / 2, y - size / 2, x - size / 2, y + size / 2}  // Right triangle
-    };
-
-    //rotation
-    for (int i = 0; i < 4; ++i) {
-        float rotated_vertices[6];
-        for (int j = 0; j < 6; ++j) {
-            if (j % 2 == 0) {
-                rotated_vertices[j] = x + (vertices[i][j] - x) * cos(angle) - (vertices[i][j + 1] - y) * sin(angle);
-            }
-            else {
-                rotated_vertices[j] = y + (vertices[i][j] - y) * cos(angle) + (vertices[i][j - 1] - x) * sin(angle);
-            }
-        }
-        draw_triangle(rotated_vertices[0], rotated_vertices[1], rotated_vertices[2], rotated_vertices[3], rotated_vertices[4], rotated_vertices[5], color);
+void draw_star(recorder_t* recorder, int x, int y, int size, uint32_t color, float angle) {
+    //Tips are the farthest points at any angle
+    if (cull_screen_object(&recorder->cull_stats, x - size, y - size, x + size, y + size, window_width, window_height)) {
+        return;
     }
-}
 
-vec2_t perspective_project_point(vec3_t point_3d) {
-    vec2_t projected_point = { .x = (scaling_factor * point_3d.x) / point_3d.z, .y = (scaling_factor * point_3d.y) / point_3d.z };
-    return projected_point;
+    record_star(recorder->active, x, y, size, angle, color);
 }
 
-void project_square_pyramid() {
-    for (int i = 0; i < N_MESH_FACES; i++) {
-        face_t mesh_face = mesh_faces[i];
-        vec3_t face_vertices[3];
-
-        face_vertices[0] = mesh_vertices[mesh_face.a - 1];
-        face_vertices[1] = mesh_vertices[mesh_face.b - 1];
-        face_vertices[2] = mesh_vertices[mesh_face.c - 1];
-
-        triangle_t projected_triangle;
-
-        for (int j = 0; j < 3; j++) {
-            vec3_t transformed_vertex = face_vertices[j];
-
-            //Rotation
-            transformed_vertex = vec3_rotate_x(transformed_vertex, square_pyramid_rotation.x);
-            transformed_vertex = vec3_rotate_y(transformed_vertex, square_pyramid_rotation.y);
-            transformed_vertex = vec3_rotate_z(transformed_vertex, square_pyramid_rotation.z);
-
-            //Translation
-            transformed_vertex = vec3_translate(transformed_vertex, square_pyramid_translation.x, square_pyramid_translation.y, square_pyramid_translation.z);
-
-            //Scaling
-            transformed_vertex = vec3_scale(transformed_vertex, square_pyramid_scaling.x, square_pyramid_scaling.y, square_pyramid_scaling.z);
+projection_t scene_projection() {
+    projection_t projection = {
+        .scaling_factor = scaling_factor,
+        .camera_z = camera_position.z,
+        .center_x = window_width / 2,
+        .center_y = window_height / 2
+    };
+    return projection;
+}
 
-            transformed_vertex.z -= camera_position.z;
+int project_into_frame_arena(recorder_t* recorder, const mesh_t* mesh, const instance_t* instances, int n_instances, const light_t* light, triangle_t** triangles) {
+    int capacity = n_instances * mesh->n_faces * MAX_CLIPPED_TRIANGLES;
+    *triangles = ARENA_ALLOC_ARRAY(&recorder->arena, triangle_t, capacity);
+    if (!*triangles) {
+        return 0;
+    }
 
-            vec2_t projected_point = perspective_project_point(transformed_vertex);
+    uint64_t start = SDL_GetPerformanceCounter();
+    int n_triangles = project_mesh_instances(mesh, instances, n_instances, scene_projection(), light, *triangles, capacity, &recorder->arena, &recorder->cull_stats);
+    recorder->project_ticks += SDL_GetPerformanceCounter() - start;
+    return n_triangles;
+}
 
-            projected_point.x += (window_width / 2);
-            projected_point.y += (window_height / 2);
+//Skips the seams left by clipping
+void draw_mesh_triangle(recorder_t* recorder, triangle_t triangle, uint32_t color) {
+    if (triangle.edge_mask == TRIANGLE_ALL_EDGES) {
+        draw_triangle(recorder, triangle.points[0].x, triangle.points[0].y,
+            triangle.points[1].x, triangle.points[1].y,
+            triangle.points[2].x, triangle.points[2].y,
+            color);
+        return;
+    }
 
-            projected_triangle.points[j] = projected_point;
+    for (int i = 0; i < 3; i++) {
+        if (triangle.edge_mask & (1 << i)) {
+            vec2_t from = triangle.points[i];
+            vec2_t to = triangle.points[(i + 1) % 3];
+            draw_line(recorder, from.x, from.y, to.x, to.y, color);
         }
-        triangles_to_render[i] = projected_triangle;
     }
 }
 
-void project_octahedron() {
-    for (int i = 0; i < N_MESH2_FACES; i++) {
-        face_t mesh2_face = mesh2_faces[i];
-        vec3_t face2_vertices[3];
-
-        face2_vertices[0] = mesh2_vertices[mesh2_face.a];
-        face2_vertices[1] = mesh2_vertices[mesh2_face.b];
-        face2_vertices[2] = mesh2_vertices[mesh2_face.c];
-
-        triangle_t projected_triangle;
-
-        for (int j = 0; j < 3; j++) {
-            vec3_t transformed_vertex = face2_vertices[j];
-
-            //Rotation
-            transformed_vertex = vec3_rotate_y(transformed_vertex, octahedron_rotation.y);
-
-            //Translation
-            transformed_vertex = vec3_translate(transformed_vertex, octahedron_translation.x, octahedron_translation.y, octahedron_translation.z);
-
-            //Scaling
-            transformed_vertex = vec3_scale(transformed_vertex, octahedron_scaling.x, octahedron_scaling.y, octahedron_scaling.z);
-
-            transformed_vertex.z -= camera_position.z;
-
-            vec2_t projected_point = perspective_project_point(transformed_vertex);
+//Flat shaded fill, or the mesh edges of an outlined face. Either way in the order it is recorded
+void draw_depth_face(recorder_t* recorder, const triangle_t* triangle) {
+    int x0 = triangle->points[0].x, y0 = triangle->points[0].y;
+    int x1 = triangle->points[1].x, y1 = triangle->points[1].y;
+    int x2 = triangle->points[2].x, y2 = triangle->points[2].y;
+    int min_x = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+    int min_y = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+    int max_x = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+    int max_y = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+    if (cull_screen_primitive(&recorder->cull_stats, min_x, min_y, max_x, max_y, window_width, window_height)) {
+        return;
+    }
 
-            projected_point.x += (window_width / 2);
-            projected_point.y += (window_height / 2);
+    record_face(recorder->active, x0, y0, x1, y1, x2, y2, triangle->outlined ? triangle->edge_mask : 0, triangle->color);
+}
 
-            projected_triangle.points[j] = projected_point;
-        }
-        triangles2_to_render[i] = projected_triangle;
+//Unlit wireframes join the depth list like the lit meshes, back edges included
+void outline_with_random_colors(recorder_t* recorder, triangle_t* triangles, int n_triangles) {
+    for (int i = 0; i < n_triangles; i++) {
+        triangles[i].outlined = true;
+        triangles[i].color = generate_random_color(recorder);
     }
 }
 
-void project_triangular_pyramid() {
-    for (int i = 0; i < N_MESH3_FACES; i++) {
-        face_t mesh3_face = mesh3_faces[i];
-        vec3_t face3_vertices[3];
-
-        face3_vertices[0] = mesh_vertices[mesh3_face.a - 1];
-        face3_vertices[1] = mesh_vertices[mesh3_face.b - 1];
-        face3_vertices[2] = mesh_vertices[mesh3_face.c - 1];
-
-        triangle_t projected_triangle;
-
-        for (int j = 0; j < 3; j++) {
-            vec3_t transformed_vertex = face3_vertices[j];
-
-            //Rotation
-            transformed_vertex = vec3_rotate_x(transformed_vertex, triangular_pyramid_rotation.x);
-            transformed_vertex = vec3_rotate_y(transformed_vertex, triangular_pyramid_rotation.y);
-            transformed_vertex = vec3_rotate_z(transformed_vertex, triangular_pyramid_rotation.z);
-
-            //Translation
-            transformed_vertex = vec3_translate(transformed_vertex, triangular_pyramid_translation.x, triangular_pyramid_translation.y, triangular_pyramid_translation.z);
-
-            //Scaling
-            transformed_vertex = vec3_scale(transformed_vertex, triangular_pyramid_scaling.x, triangular_pyramid_scaling.y, triangular_pyramid_scaling.z);
-
-            transformed_vertex.z -= camera_position.z;
-
-            vec2_t projected_point = perspective_project_point(transformed_vertex);
-
-            projected_point.x += (window_width / 2);
-            projected_point.y += (window_height / 2);
-
-            projected_triangle.points[j] = projected_point;
-        }
-        triangles3_to_render[i] = projected_triangle;
+void draw_mesh_instances(recorder_t* recorder, const triangle_t* triangles, int n_triangles) {
+    for (int i = 0; i < n_triangles; i++) {
+        draw_mesh_triangle(recorder, triangles[i], triangles[i].color);
     }
 }
 
-void project_octahedron2() {
-    for (int i = 0; i < N_MESH2_FACES; i++) {
-        face_t mesh2_face = mesh2_faces[i];
-        vec3_t face2_vertices[3];
-
-        face2_vertices[0] = mesh2_vertices[mesh2_face.a];
-        face2_vertices[1] = mesh2_vertices[mesh2_face.b];
-        face2_vertices[2] = mesh2_vertices[mesh2_face.c];
-
-        triangle_t projected_triangle;
-
-        for (int j = 0; j < 3; j++) {
-            vec3_t transformed_vertex = face2_vertices[j];
-
-            //Rotation
-            transformed_vertex = vec3_rotate_y(transformed_vertex, octahedron2_rotation.y);
+//Painter's algorithm over every mesh face of the frame, so meshes may overlap without a depth buffer
+void draw_depth_sorted_faces(recorder_t* recorder) {
+    sort_depth_list(&recorder->faces);
+    for (int i = 0; i < recorder->faces.count; i++) {
+        draw_depth_face(recorder, recorder->faces.faces[i]);
+    }
+    reset_depth_list(&recorder->faces);
+}
 
-            //Translation
-            transformed_vertex = vec3_translate(transformed_vertex, octahedron2_translation.x, octahedron2_translation.y, octahedron2_translation.z);
+int project_square_pyramid(recorder_t* recorder, transform_t placement, triangle_t** triangles) {
+    instance_t instance = {
+        .scaling = placement.scaling,
+        .rotation = placement.rotation,
+        .translation = placement.translation,
+        .color = 0xFF0000
+    };
+    return project_into_frame_arena(recorder, &square_pyramid_mesh, &instance, 1, &scene_light, triangles);
+}
 
-            //Scaling
-            transformed_vertex = vec3_scale(transformed_vertex, octahedron2_scaling.x, octahedron2_scaling.y, octahedron2_scaling.z);
+int project_octahedron(recorder_t* recorder, transform_t placement, triangle_t** triangles) {
+    //Only spins around y
+    instance_t instance = {
+        .scaling = placement.scaling,
+        .rotation = {.x = 0, .y = placement.rotation.y, .z = 0 },
+        .translation = placement.translation
+    };
+    return project_into_frame_arena(recorder, &octahedron_mesh, &instance, 1, NULL, triangles);
+}
 
-            transformed_vertex.z -= camera_position.z;
+int project_triangular_pyramid(recorder_t* recorder, transform_t placement, triangle_t** triangles) {
+    instance_t instance = {
+        .scaling = placement.scaling,
+        .rotation = placement.rotation,
+        .translation = placement.translation,
+        .color = 0x00FF00
+    };
+    return project_into_frame_arena(recorder, &triangular_pyramid_mesh, &instance, 1, &scene_light, triangles);
+}
 
-            vec2_t projected_point = perspective_project_point(transformed_vertex);
+int project_octahedron2(recorder_t* recorder, transform_t placement, triangle_t** triangles) {
+    //Only spins around y
+    instance_t instance = {
+        .scaling = placement.scaling,
+        .rotation = {.x = 0, .y = placement.rotation.y, .z = 0 },
+        .translation = placement.translation,
+        .color = 0xFFEA00
+    };
+    return project_into_frame_arena(recorder, &octahedron_mesh, &instance, 1, &scene_light, triangles);
+}
 
-            projected_point.x += (window_width / 2);
-            projected_point.y += (window_height / 2);
+//Frames of FRAME_TARGET_TIME since a moment of the timeline, 0 before it
+float frames_since(uint32_t elapsed_time, uint32_t moment) {
+    return elapsed_time > moment ? (float)(elapsed_time - moment) / FRAME_TARGET_TIME : 0;
+}
 
-            projected_triangle.points[j] = projected_point;
-        }
-        triangles2_to_render[i] = projected_triangle;
+//What adding amplitude * sin(t * 0.001) every frame since moment sums up to
+float breathing_drift(uint32_t elapsed_time, uint32_t moment, float amplitude) {
+    if (elapsed_time <= moment) {
+        return 0;
     }
+    return amplitude * (cosf(moment * 0.001f) - cosf(elapsed_time * 0.001f)) / (0.001f * FRAME_TARGET_TIME);
+}
+
+//Starts at 0 and moves right or down, past extent it comes back in from -70
+int scrolled_position(float distance, int extent) {
+    return (int)fmodf(distance + 70, (float)(extent + 70)) - 70;
 }
 
 void update_state() {
-    static bool square_pyramid_appeared = false;
-    static bool octahedron_appeared = false;
-    static bool triangular_pyramid_appeared = false;
-    static bool octahedron2_appeared = false;
-    static bool cloud_appeared = false;
-    static bool snow_appeared = false;
-    static bool snowman_appeared = false;
-    static bool polygon_appeared = false;
-    static bool tree_appeared = false;
-    static bool star_appeared = false;
     static uint32_t start_time = 0;   
     uint32_t current_time = SDL_GetTicks();
 
@@ -541,15 +691,65 @@ void update_state() {
         start_time = current_time;
     }
 
-    uint32_t elapsed_time = current_time - start_time;
-    clear_color_buffer(0xFF000000);
+    record_scene(&frame_recorder, current_time - start_time);
+    cull_stats = frame_recorder.cull_stats;
+    hud_add_stage_ticks(HUD_STAGE_PROJECT, frame_recorder.project_ticks);
+
+    int time_to_wait = FRAME_TARGET_TIME - (SDL_GetTicks() - previous_frame_time);
+
+    if (time_to_wait > 0 && time_to_wait <= FRAME_TARGET_TIME) {
+        SDL_Delay(time_to_wait);
+    }
+    previous_frame_time = SDL_GetTicks();
+}
+
+//Everything, including the animation, is worked out from elapsed_time alone, advancing by
+//what each frame of FRAME_TARGET_TIME used to add, so any frame can be recorded on its own.
+//Only the recorder is written, so threads with a recorder each can record frames in parallel
+void record_scene(recorder_t* recorder, uint32_t elapsed_time) {
+    bool square_pyramid_appeared = false;
+    bool octahedron_appeared = false;
+    bool triangular_pyramid_appeared = false;
+    bool octahedron2_appeared = false;
+    bool cloud_appeared = false;
+    bool snow_appeared = false;
+    bool snowman_appeared = false;
+    bool polygon_appeared = false;
+    bool tree_appeared = false;
+    bool star_appeared = false;
+
+    //Mesh placements, worked out below once each mesh has appeared
+    transform_t square_pyramid = identity_transform();
+    transform_t octahedron = identity_transform();
+    octahedron.scaling.y = 3;
+    transform_t triangular_pyramid = identity_transform();
+    transform_t octahedron2 = identity_transform();
+    triangle_t* triangles = NULL;
+
+    //Random colors and snow come out the same whenever the frame is recorded
+    seed_random(recorder, elapsed_time / FRAME_TARGET_TIME);
+
+    //The cloud is drawn twice a frame from the tree on, so it moves twice as fast
+    int rect_x = scrolled_position(5 * (frames_since(elapsed_time, 0) + frames_since(elapsed_time, 80000)), window_width);
+    int poly_y = scrolled_position(5 * N_HEXAGONS * frames_since(elapsed_time, 85000), window_height);
+
+    //Children follow at the update
+    vec3_t snowman_position = {.x = scrolled_position(5 * frames_since(elapsed_time, 30000), window_width), .y = window_height / 2, .z = 0 };
+    vec3_t tree_position = {.x = window_width / 2, .y = window_height - 70, .z = 0 };
+    set_node_translation(&recorder->scene, SNOWMAN_NODE, snowman_position);
+    set_node_translation(&recorder->scene, TREE_NODE, tree_position);
+    update_scene_graph(&recorder->scene);
+
+    reset_cull_stats(&recorder->cull_stats);
+    recorder->project_ticks = 0;
+    clear_color_buffer(recorder, 0xFF000000);
 
     //Cloud
     if (elapsed_time >= 0) {
         cloud_appeared = true;
     }
     if (cloud_appeared) {
-        draw_cloud();
+        draw_cloud(recorder, rect_x);
     }
     
     //Snow appear
@@ -557,7 +757,7 @@ void update_state() {
         snow_appeared = true;
     }
     if (snow_appeared) {
-        draw_snow();
+        draw_snow(recorder);
     }
 
     //Snowman
@@ -565,209 +765,167 @@ void update_state() {
         snowman_appeared = true;
     }
     if (snowman_appeared) {
-        draw_snowman();
+        draw_snowman(recorder);
     }
 
     //Star
     if (elapsed_time >= 48000) {
-        clear_color_buffer(0xFF000000);
+        clear_color_buffer(recorder, 0xFF000000);
         cloud_appeared = false;
         snow_appeared = false;
         snowman_appeared = false;
         star_appeared = true;
     }
     if (star_appeared) {
-        float speed = 0.01;
-        static float angle = 0;
-        angle += speed;
+        float angle = 0.01f * frames_since(elapsed_time, 48000);
         if (elapsed_time >= 48000) {
-            draw_star(window_width / 2, window_height / 2, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2, window_height / 2, 100, 0xFFFF00, angle);
         }
         if (elapsed_time >= 48300) {
-            draw_star(window_width / 2 - 300, window_height / 2 - 400, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2 - 300, window_height / 2 - 400, 100, 0xFFFF00, angle);
         }
         if (elapsed_time >= 48600) {
-            draw_star(window_width / 2 + 200, window_height / 2 + 500, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2 + 200, window_height / 2 + 500, 100, 0xFFFF00, angle);
         }
     }
 
     //Square pyramid
     if (elapsed_time >= 49000) {
-        clear_color_buffer(0xFF000000);
+        clear_color_buffer(recorder, 0xFF000000);
         star_appeared = false;
         square_pyramid_appeared = true;
     }
     
     if (square_pyramid_appeared) {
-        square_pyramid_rotation.x += 0.01;
-        square_pyramid_rotation.y += 0.01;
-        square_pyramid_rotation.z += 0.01;
+        float spin = 0.01f * frames_since(elapsed_time, 49000);
+        square_pyramid.rotation.x = spin;
+        square_pyramid.rotation.y = spin;
+        square_pyramid.rotation.z = spin;
 
         //Breathing effects
         float breathing_factor = sin(elapsed_time * 0.001); 
-        square_pyramid_scaling.x = 0.8 + breathing_factor * 0.1; 
-        float translation_factor = breathing_factor * 0.1; 
+        square_pyramid.scaling.x = 0.8 + breathing_factor * 0.1; 
 
-        square_pyramid_translation.x += translation_factor;
+        square_pyramid.translation.x = breathing_drift(elapsed_time, 49000, 0.1f);
         
-        project_square_pyramid();
-        for (int i = 0; i < N_MESH_FACES; i++) {
-            triangle_t triangle = triangles_to_render[i];
-            draw_triangle(triangle.points[0].x, triangle.points[0].y,
-                triangle.points[1].x, triangle.points[1].y,
-                triangle.points[2].x, triangle.points[2].y,
-                0xFF0000);
-        }
+        int n_triangles = project_square_pyramid(recorder, square_pyramid, &triangles);
+        add_depth_faces(&recorder->faces, triangles, n_triangles);
     }
     
     //Star
     if (elapsed_time >= 56000) {
-        clear_color_buffer(0xFF000000);
+        clear_color_buffer(recorder, 0xFF000000);
         square_pyramid_appeared = false;
         star_appeared = true;
 
-        float speed = 0.01;
-        static float angle = 0;
-        angle += speed;
+        float angle = 0.01f * frames_since(elapsed_time, 56000);
         if (elapsed_time >= 56000) {
-            draw_star(window_width / 2, window_height / 2, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2, window_height / 2, 100, 0xFFFF00, angle);
         }
         if (elapsed_time >= 56300) {
-            draw_star(window_width / 2 - 100, window_height / 2 - 300, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2 - 100, window_height / 2 - 300, 100, 0xFFFF00, angle);
         }
         if (elapsed_time >= 56600) {
-            draw_star(window_width / 2 + 400, window_height / 2 + 400, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2 + 400, window_height / 2 + 400, 100, 0xFFFF00, angle);
         }
     }
 
     //Octahedron
     if (elapsed_time >= 57000) {
-        clear_color_buffer(0xFF000000);
+        clear_color_buffer(recorder, 0xFF000000);
         star_appeared = false;
         octahedron_appeared = true;
     }
 
     if (octahedron_appeared) {
-        octahedron_rotation.x += 0.01;
-        octahedron_rotation.y += 0.01;
-        octahedron_rotation.z += 0.01;
-
-        project_octahedron();
-        for (int i = 0; i < N_MESH2_FACES; i++) {
-            triangle_t triangle = triangles2_to_render[i];
-            draw_triangle(triangle.points[0].x, triangle.points[0].y,
-                triangle.points[1].x, triangle.points[1].y,
-                triangle.points[2].x, triangle.points[2].y,
-                generate_random_color());
-        }
+        float spin = 0.01f * frames_since(elapsed_time, 57000);
+        octahedron.rotation.x = spin;
+        octahedron.rotation.y = spin;
+        octahedron.rotation.z = spin;
+
+        int n_triangles2 = project_octahedron(recorder, octahedron, &triangles);
+        outline_with_random_colors(recorder, triangles, n_triangles2);
+        add_depth_faces(&recorder->faces, triangles, n_triangles2);
     }
     
     //Star
     if (elapsed_time >= 63500) {
-        clear_color_buffer(0xFF000000);
+        clear_color_buffer(recorder, 0xFF000000);
         octahedron_appeared = false;
         star_appeared = true;
 
-        float speed = 0.01;
-        static float angle = 0;
-        angle += speed;
+        float angle = 0.01f * frames_since(elapsed_time, 63500);
         if (elapsed_time >= 63500) {
-            draw_star(window_width / 2, window_height / 2, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2, window_height / 2, 100, 0xFFFF00, angle);
         }
         if (elapsed_time >= 63800) {
-            draw_star(window_width / 2 - 550, window_height / 2 - 150, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2 - 550, window_height / 2 - 150, 100, 0xFFFF00, angle);
         }
         if (elapsed_time >= 64100) {
-            draw_star(window_width / 2 + 430, window_height / 2 + 250, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2 + 430, window_height / 2 + 250, 100, 0xFFFF00, angle);
         }
     }
     
     //Triangular pyramid
     if (elapsed_time >= 65000) {
-        clear_color_buffer(0xFF000000);
+        clear_color_buffer(recorder, 0xFF000000);
         star_appeared = false;
         triangular_pyramid_appeared = true;
     }
 
     if (triangular_pyramid_appeared) {
-        triangular_pyramid_rotation.x += 0.01;
+        triangular_pyramid.rotation.x = 0.01f * frames_since(elapsed_time, 65000);
 
         //Breathing effects
         float breathing_factor = sin(elapsed_time * 0.001); 
-        triangular_pyramid_scaling.y = 0.8 + breathing_factor * 0.01; 
-        float translation_factor = breathing_factor * 0.05; 
-
-        triangular_pyramid_translation.y += translation_factor;
-
-        project_triangular_pyramid();
-        for (int i = 0; i < N_MESH_FACES; i++) {
-            triangle_t triangle = triangles3_to_render[i];
-            draw_triangle(triangle.points[0].x, triangle.points[0].y,
-                triangle.points[1].x, triangle.points[1].y,
-                triangle.points[2].x, triangle.points[2].y,
-                0x00FF00);
-        }
+        triangular_pyramid.scaling.y = 0.8 + breathing_factor * 0.01; 
+
+        triangular_pyramid.translation.y = breathing_drift(elapsed_time, 65000, 0.05f);
+
+        int n_triangles3 = project_triangular_pyramid(recorder, triangular_pyramid, &triangles);
+        add_depth_faces(&recorder->faces, triangles, n_triangles3);
     }
 
     //Star
     if (elapsed_time >= 71500) {
-        clear_color_buffer(0xFF000000);
+        clear_color_buffer(recorder, 0xFF000000);
         triangular_pyramid_appeared = false;
         star_appeared = true;
-        float speed = 0.01;
-        static float angle = 0;
-        angle += speed;
+        float angle = 0.01f * frames_since(elapsed_time, 71500);
 
         if (elapsed_time >= 71500) {
-            draw_star(window_width / 2, window_height / 2, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2, window_height / 2, 100, 0xFFFF00, angle);
         }
         if (elapsed_time >= 71800) {
-            draw_star(window_width / 2 - 300, window_height / 2 - 140, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2 - 300, window_height / 2 - 140, 100, 0xFFFF00, angle);
         }
         if (elapsed_time >= 72100) {
-            draw_star(window_width / 2 + 130, window_height / 2 + 150, 100, 0xFFFF00, angle);
+            draw_star(recorder, window_width / 2 + 130, window_height / 2 + 150, 100, 0xFFFF00, angle);
         }
     }
 
     //All 3d
     if (elapsed_time >= 73000) {
-        clear_color_buffer(0xFF000000);
+        clear_color_buffer(recorder, 0xFF000000);
         star_appeared = false;
         square_pyramid_appeared = true;
         octahedron_appeared = true;
         triangular_pyramid_appeared = true;
         
-        project_square_pyramid();
-        for (int i = 0; i < N_MESH_FACES; i++) {
-            triangle_t triangle = triangles_to_render[i];
-            draw_triangle(triangle.points[0].x, triangle.points[0].y,
-                triangle.points[1].x, triangle.points[1].y,
-                triangle.points[2].x, triangle.points[2].y,
-                0xFF0000);
-        }
+        int n_triangles = project_square_pyramid(recorder, square_pyramid, &triangles);
+        add_depth_faces(&recorder->faces, triangles, n_triangles);
 
-        project_octahedron();
-        for (int i = 0; i < N_MESH2_FACES; i++) {
-            triangle_t triangle = triangles2_to_render[i];
-            draw_triangle(triangle.points[0].x, triangle.points[0].y,
-                triangle.points[1].x, triangle.points[1].y,
-                triangle.points[2].x, triangle.points[2].y,
-                generate_random_color());
-        }
+        int n_triangles2 = project_octahedron(recorder, octahedron, &triangles);
+        outline_with_random_colors(recorder, triangles, n_triangles2);
+        add_depth_faces(&recorder->faces, triangles, n_triangles2);
 
-        project_triangular_pyramid();
-        for (int i = 0; i < N_MESH_FACES; i++) {
-            triangle_t triangle = triangles3_to_render[i];
-            draw_triangle(triangle.points[0].x, triangle.points[0].y,
-                triangle.points[1].x, triangle.points[1].y,
-                triangle.points[2].x, triangle.points[2].y,
-                0x00FF00);
-        }
+        int n_triangles3 = project_triangular_pyramid(recorder, triangular_pyramid, &triangles);
+        add_depth_faces(&recorder->faces, triangles, n_triangles3);
     }
 
     //Tree
     if (elapsed_time >= 80000) {
-        clear_color_buffer(0xFF000000);
+        clear_color_buffer(recorder, 0xFF000000);
         square_pyramid_appeared = false;
         octahedron_appeared = false;
         triangular_pyramid_appeared = false;
@@ -777,9 +935,19 @@ void update_state() {
         snow_appeared = true;
     }
     if (tree_appeared) {
-        draw_tree(window_width / 2, window_height - 70, 50, 245, generate_random_color());
-        draw_cloud();
-        draw_snow();
+        //Only redrawn when what they record differs from last frame, so the tree changes colors
+        //every TREE_TWINKLE_TIME instead of every frame
+        vec3_t tree = node_position(&recorder->scene, TREE_NODE);
+        vec3_t star = node_position(&recorder->scene, TREE_STAR_NODE);
+        seed_random(recorder, elapsed_time / TREE_TWINKLE_TIME);
+        begin_layer(recorder, LAYER_SCENERY);
+        draw_tree(recorder, (int)tree.x, (int)tree.y, 50, TREE_TRUNK_HEIGHT, generate_random_color(recorder));
+        draw_star(recorder, (int)star.x, (int)star.y, 30, 0xFFFF00, 0);
+        end_layer(recorder);
+        //Back to a per-frame seed for what follows. The clouds move every frame, they stay out of the layers
+        seed_random(recorder, ~(elapsed_time / FRAME_TARGET_TIME));
+        draw_cloud(recorder, rect_x);
+        draw_snow(recorder);
     }
 
     //Polygon
@@ -787,16 +955,7 @@ void update_state() {
         polygon_appeared = true;
     }
     if (polygon_appeared) {
-        draw_polygon(100, 100, 150, 150, 200, 100, 200, 200, 150, 250, 100, 200, generate_random_color());
-        draw_polygon(300, 200, 350, 250, 400, 200, 400, 300, 350, 350, 300, 300, generate_random_color());
-        draw_polygon(500, 300, 550, 350, 600, 300, 600, 400, 550, 450, 500, 400, generate_random_color());
-        draw_polygon(700, 400, 750, 450, 800, 400, 800, 500, 750, 550, 700, 500, generate_random_color());
-        draw_polygon(900, 500, 950, 550, 1000, 500, 1000, 600, 950, 650, 900, 600, generate_random_color());
-        draw_polygon(window_width - 100, 100, window_width - 150, 150, window_width - 200, 100, window_width - 200, 200, window_width - 150, 250, window_width - 100, 200, generate_random_color());
-        draw_polygon(window_width - 300, 200, window_width - 350, 250, window_width - 400, 200, window_width - 400, 300, window_width - 350, 350, window_width - 300, 300, generate_random_color());
-        draw_polygon(window_width - 500, 300, window_width - 550, 350, window_width - 600, 300, window_width - 600, 400, window_width - 550, 450, window_width - 500, 400, generate_random_color());
-        draw_polygon(window_width - 700, 400, window_width - 750, 450, window_width - 800, 400, window_width - 800, 500, window_width - 750, 550, window_width - 700, 500, generate_random_color());
-        draw_polygon(window_width - 900, 500, window_width - 950, 550, window_width - 1000, 500, window_width - 1000, 600, window_width - 950, 650, window_width - 900, 600, generate_random_color());
+        draw_hexagons(recorder, poly_y);
     }
 
     //Octahedron2
@@ -805,32 +964,22 @@ void update_state() {
     }
 
     if (octahedron2_appeared) {
-        octahedron2_rotation.x += 0.01;
-        octahedron2_rotation.y += 0.01;
-        octahedron2_rotation.z += 0.01;
+        float frames = frames_since(elapsed_time, 90000);
+        octahedron2.rotation.x = 0.01f * frames;
+        octahedron2.rotation.y = 0.01f * frames;
+        octahedron2.rotation.z = 0.01f * frames;
 
-        if (octahedron2_translation.x > window_width) {
-            octahedron2_translation.x += 0.1;
-            octahedron2_scaling.z += 0.1;
-        }
-        else if (octahedron2_translation.x < window_width) {
-            octahedron2_translation.x -= 0.1;
-            octahedron2_scaling.z -= 0.1;
-        }
+        //Starts left of window_width, so it only ever drifts left while flattening
+        octahedron2.translation.x = -0.1f * frames;
+        octahedron2.scaling.z = 1 - 0.1f * frames;
 
-        project_octahedron2();
-        for (int i = 0; i < N_MESH2_FACES; i++) {
-            triangle_t triangle = triangles2_to_render[i];
-            draw_triangle(triangle.points[0].x, triangle.points[0].y,
-                triangle.points[1].x, triangle.points[1].y,
-                triangle.points[2].x, triangle.points[2].y,
-                0xFFEA00);
-        }
+        int n_triangles2 = project_octahedron2(recorder, octahedron2, &triangles);
+        add_depth_faces(&recorder->faces, triangles, n_triangles2);
     }
     
     //Clear all
     if (elapsed_time >= 103000) {
-        clear_color_buffer(0xFF000000);
+        clear_color_buffer(recorder, 0xFF000000);
         cloud_appeared = false;
         snow_appeared = false;
         tree_appeared = false;
@@ -838,15 +987,184 @@ void update_state() {
         octahedron2_appeared = false;
     }
 
-    int time_to_wait = FRAME_TARGET_TIME - (SDL_GetTicks() - previous_frame_time);
+    draw_depth_sorted_faces(recorder);
+}
 
-    if (time_to_wait > 0 && time_to_wait <= FRAME_TARGET_TIME) {
-        SDL_Delay(time_to_wait);
+static bool prepare_offline_recorder(recorder_t* recorder, void* user) {
+    return build_scene_graph(&recorder->scene);
+}
+
+static void record_offline_frame(recorder_t* recorder, uint32_t scene_time, void* user) {
+    record_scene(recorder, scene_time);
+}
+
+//Order sensitive, so every thread count has to deliver the same frames in the same order
+static void checksum_offline_frame(int frame, const uint32_t* pixels, int width, int height, void* user) {
+    uint64_t* checksum = (uint64_t*)user;
+    uint64_t hash = *checksum ^ (uint64_t)frame;
+    for (int i = 0; i < width * height; i += 61) {
+        hash = (hash ^ pixels[i]) * 1099511628211ULL;
     }
-    previous_frame_time = SDL_GetTicks();
+    *checksum = hash;
 }
 
-int main(void) {
+static void write_offline_frame(int frame, const uint32_t* pixels, int width, int height, void* user) {
+    write_delta_frame((delta_writer_t*)user, pixels);
+}
+
+//Recording state for the whole timeline at the offline size, without a window
+static offline_job_t begin_offline_timeline(void) {
+    window_width = OFFLINE_WIDTH;
+    window_height = OFFLINE_HEIGHT;
+    init_instance_workers();
+    prepare_meshes();
+
+    offline_job_t job = {
+        .width = window_width,
+        .height = window_height,
+        .n_frames = TIMELINE_LENGTH / FRAME_TARGET_TIME,
+        .frame_ms = FRAME_TARGET_TIME,
+        .n_threads = offline_thread_count(),
+        .antialiased_lines = antialiased_lines,
+        .prepare = prepare_offline_recorder,
+        .record = record_offline_frame
+    };
+    return job;
+}
+
+static void end_offline_timeline(void) {
+    free_instance_workers();
+}
+
+//Renders the whole timeline at doubling thread counts up to one per core
+int run_offline_benchmark(void) {
+    offline_job_t job = begin_offline_timeline();
+    job.output = checksum_offline_frame;
+
+    int max_threads = job.n_threads;
+    double single_thread_seconds = 0;
+    printf("%d frames at %dx%d\n", job.n_frames, job.width, job.height);
+    printf("threads  seconds      fps  speedup  checksum\n");
+
+    for (int n_threads = 1; ; n_threads *= 2) {
+        n_threads = n_threads < max_threads ? n_threads : max_threads;
+        uint64_t checksum = 14695981039346656037ULL;
+        job.n_threads = n_threads;
+        job.user = &checksum;
+
+        double seconds = render_offline(&job);
+        if (seconds < 0) {
+            fprintf(stderr, "render_offline() could not set up %d workers\n", n_threads);
+            break;
+        }
+        if (n_threads == 1) {
+            single_thread_seconds = seconds;
+        }
+        printf("%7d  %7.2f  %7.1f  %6.2fx  %016llx\n", n_threads, seconds, job.n_frames / seconds,
+            single_thread_seconds / seconds, (unsigned long long)checksum);
+        if (n_threads == max_threads) {
+            break;
+        }
+    }
+
+    end_offline_timeline();
+    return 0;
+}
+
+//Renders the whole timeline on every core into a delta stream
+int run_offline_export(const char* path) {
+    offline_job_t job = begin_offline_timeline();
+    delta_writer_t writer;
+    if (!open_delta_writer(&writer, path, job.width, job.height)) {
+        fprintf(stderr, "open_delta_writer() failed for %s\n", path);
+        end_offline_timeline();
+        return 1;
+    }
+    job.output = write_offline_frame;
+    job.user = &writer;
+
+    double seconds = render_offline(&job);
+    double raw_bytes = (double)job.n_frames * job.width * job.height * sizeof(uint32_t);
+    printf("%d frames in %.2f s, %llu bytes (%.1f%% of raw), %.1f%% of tiles repeated\n", writer.n_frames, seconds,
+        (unsigned long long)writer.bytes_written, 100.0 * writer.bytes_written / raw_bytes, 100.0 * total_skipped_fraction(&writer.tiles));
+
+    bool written = close_delta_writer(&writer);
+    if (!written || seconds < 0) {
+        fprintf(stderr, "Exporting %s failed\n", path);
+    }
+    end_offline_timeline();
+    return written && seconds >= 0 ? 0 : 1;
+}
+
+//Update cost of a random 100K node forest when 1% and when every node has moved
+int run_scene_benchmark(void) {
+    scene_graph_t graph = { 0 };
+    srand(1);
+    for (int i = 0; i < BENCH_SCENE_NODES; i++) {
+        //Trees of 64 nodes, each node hanging off a random earlier node of its tree
+        int root = i - i % 64;
+        int parent = i == root ? -1 : root + rand() % (i - root);
+        if (add_scene_node(&graph, parent, translation_transform((float)(rand() % 100), (float)(rand() % 100))) < 0) {
+            fprintf(stderr, "add_scene_node() failed at node %d\n", i);
+            free_scene_graph(&graph);
+            return 1;
+        }
+    }
+    update_scene_graph(&graph);
+
+    int percents[2] = { 1, 100 };
+    printf("%d nodes\n", graph.n_nodes);
+    printf("dirty  recomputed  us/update\n");
+    for (int p = 0; p < 2; p++) {
+        int n_dirty = graph.n_nodes * percents[p] / 100;
+        int recomputed = 0;
+        uint64_t elapsed = 0;
+
+        for (int u = 0; u < BENCH_SCENE_UPDATES; u++) {
+            for (int d = 0; d < n_dirty; d++) {
+                int node = n_dirty == graph.n_nodes ? d : rand() % graph.n_nodes;
+                transform_t local = graph.locals[node];
+                local.rotation.z += 0.01f;
+                set_node_transform(&graph, node, local);
+            }
+
+            uint64_t start = SDL_GetPerformanceCounter();
+            update_scene_graph(&graph);
+            elapsed += SDL_GetPerformanceCounter() - start;
+            recomputed += graph.n_updated;
+        }
+
+        printf("%4d%%  %10d  %9.1f\n", percents[p], recomputed / BENCH_SCENE_UPDATES,
+            1e6 * elapsed / SDL_GetPerformanceFrequency() / BENCH_SCENE_UPDATES);
+    }
+
+    free_scene_graph(&graph);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--offline") == 0) {
+        return run_offline_benchmark();
+    }
+    if (argc > 2 && strcmp(argv[1], "--export") == 0) {
+        return run_offline_export(argv[2]);
+    }
+    if (argc > 1 && strcmp(argv[1], "--scene-bench") == 0) {
+        return run_scene_benchmark();
+    }
+    if (argc > 1 && strcmp(argv[1], "--instance-bench") == 0) {
+        return run_instance_benchmark();
+    }
+    if (argc > 1 && strcmp(argv[1], "--depth-bench") == 0) {
+        return run_depth_benchmark();
+    }
+    if (argc > 1 && strcmp(argv[1], "--line-bench") == 0) {
+        return run_line_benchmark();
+    }
+    if (argc > 1 && strcmp(argv[1], "--ellipse-bench") == 0) {
+        return run_ellipse_benchmark();
+    }
+
     is_running = initialize_windowing_system(); 
     setup_memory_buffers();
 
@@ -855,6 +1173,8 @@ int main(void) {
         process_keyboard_input(); 
         update_state();
         run_render_pipeline();
+        arena_reset(&frame_recorder.arena);
+        hud_next_frame();
     }
     clean_up();
     return 0;
@@ -0,0 +1,140 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef _DEBUG
+//Every allocation is preceded by a header and followed by a guard band
+#define ARENA_GUARD_SIZE 16
+#define ARENA_GUARD_BYTE 0xFD
+#define ARENA_POISON_BYTE 0xCD
+
+typedef struct {
+    size_t size;
+    size_t previous; //offset of the allocation before this one, 0 for none
+} arena_header_t;
+
+#define ARENA_HEADER_SIZE sizeof(arena_header_t)
+#else
+#define ARENA_GUARD_SIZE 0
+#define ARENA_HEADER_SIZE 0
+#endif
+
+//Overflow chunks keep the arena usable when a frame needs more than the base block
+typedef struct arena_chunk {
+    struct arena_chunk* next;
+#ifdef _DEBUG
+    uint8_t* data; //followed by its guard band like base block allocations
+    size_t size;
+#endif
+} arena_chunk_t;
+
+static size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+bool arena_init(arena_t* arena, size_t capacity) {
+    arena_t empty = { 0 };
+    *arena = empty;
+    arena->base = (uint8_t*)malloc(capacity);
+    if (!arena->base) {
+        return false;
+    }
+    arena->capacity = capacity;
+    return true;
+}
+
+void arena_free(arena_t* arena) {
+    arena_reset(arena);
+    free(arena->base);
+    arena_t empty = { 0 };
+    *arena = empty;
+}
+
+static void* arena_alloc_overflow(arena_t* arena, size_t size, size_t align) {
+    size_t header = align_up(sizeof(arena_chunk_t), align);
+    arena_chunk_t* chunk = (arena_chunk_t*)malloc(header + size + align + ARENA_GUARD_SIZE);
+    if (!chunk) {
+        return NULL;
+    }
+    chunk->next = (arena_chunk_t*)arena->overflow;
+    arena->overflow = chunk;
+
+    uintptr_t data = align_up((uintptr_t)chunk + header, align);
+#ifdef _DEBUG
+    chunk->data = (uint8_t*)data;
+    chunk->size = size;
+    memset(chunk->data + size, ARENA_GUARD_BYTE, ARENA_GUARD_SIZE);
+#endif
+    return (void*)data;
+}
+
+void* arena_alloc(arena_t* arena, size_t size, size_t align) {
+    //The base block is malloc aligned, so aligning offsets aligns addresses
+    if (align < sizeof(void*)) {
+        align = sizeof(void*);
+    }
+    size_t start = align_up(arena->offset + ARENA_HEADER_SIZE, align);
+    size_t end = start + size + ARENA_GUARD_SIZE;
+    arena->peak += end - arena->offset;
+
+    if (end > arena->capacity) {
+        return arena_alloc_overflow(arena, size, align);
+    }
+
+#ifdef _DEBUG
+    arena_header_t* allocation = (arena_header_t*)(arena->base + start - ARENA_HEADER_SIZE);
+    allocation->size = size;
+    allocation->previous = arena->last;
+    arena->last = start;
+    memset(arena->base + start + size, ARENA_GUARD_BYTE, ARENA_GUARD_SIZE);
+#endif
+
+    arena->offset = end;
+    return arena->base + start;
+}
+
+void arena_reset(arena_t* arena) {
+#ifdef _DEBUG
+    //Walk back through the allocations and check nothing wrote past its end
+    for (size_t start = arena->last; start != 0;) {
+        arena_header_t* allocation = (arena_header_t*)(arena->base + start - ARENA_HEADER_SIZE);
+        for (size_t i = 0; i < ARENA_GUARD_SIZE; i++) {
+            assert(arena->base[start + allocation->size + i] == ARENA_GUARD_BYTE && "arena allocation overrun");
+        }
+        start = allocation->previous;
+    }
+    if (arena->base) {
+        memset(arena->base, ARENA_POISON_BYTE, arena->offset);
+    }
+    arena->last = 0;
+#endif
+
+    //Only frames that spilled pay for freeing, and the base grows so the next one fits
+    if (arena->overflow) {
+        while (arena->overflow) {
+            arena_chunk_t* chunk = (arena_chunk_t*)arena->overflow;
+            arena->overflow = chunk->next;
+#ifdef _DEBUG
+            for (size_t i = 0; i < ARENA_GUARD_SIZE; i++) {
+                assert(chunk->data[chunk->size + i] == ARENA_GUARD_BYTE && "arena overflow allocation overrun");
+            }
+            memset(chunk->data, ARENA_POISON_BYTE, chunk->size);
+#endif
+            free(chunk);
+        }
+
+        size_t capacity = arena->capacity > 0 ? arena->capacity : FRAME_ARENA_SIZE;
+        while (capacity < arena->peak) {
+            capacity *= 2;
+        }
+        uint8_t* base = (uint8_t*)realloc(arena->base, capacity);
+        if (base) {
+            arena->base = base;
+            arena->capacity = capacity;
+        }
+    }
+
+    arena->offset = 0;
+    arena->peak = 0;
+}
@@ -0,0 +1,32 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+//Transient per-frame memory, released all at once by arena_reset() at the end of the frame
+#define FRAME_ARENA_SIZE (4 * 1024 * 1024)
+
+typedef struct {
+    uint8_t* base;
+    size_t capacity;
+    size_t offset;
+    size_t peak; //bytes wanted this frame, including what spilled into overflow chunks
+    void* overflow; //malloc'd chunks used once base is full, folded into base on reset
+    size_t last; //debug builds: offset of the newest allocation, for the guard walk
+} arena_t;
+
+bool arena_init(arena_t* arena, size_t capacity);
+void arena_free(arena_t* arena);
+
+//Not thread safe, carve out per-worker buffers before starting threads. Never returns
+//NULL unless the heap is exhausted
+void* arena_alloc(arena_t* arena, size_t size, size_t align);
+
+//O(1) in release builds. Debug builds check every guard band and poison the memory
+void arena_reset(arena_t* arena);
+
+//16 byte aligned so SSE loads and stores never straddle
+#define ARENA_ALLOC_ARRAY(arena, type, count) ((type*)arena_alloc((arena), sizeof(type) * (size_t)(count), 16))
+
+#endif
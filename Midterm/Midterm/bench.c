@@ -0,0 +1,314 @@
+#include "bench.h"
+#include "arena.h"
+#include "depth.h"
+#include "cull.h"
+#include "instance.h"
+#include "mesh.h"
+#include "raster.h"
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Instance counts timed by run_instance_benchmark, each over BENCH_INSTANCE_RUNS batches
+#define BENCH_INSTANCE_RUNS 5
+static const int bench_instance_counts[] = { 10000, 100000 };
+
+//Face counts timed by run_depth_benchmark, each sorted BENCH_DEPTH_RUNS times
+#define BENCH_DEPTH_RUNS 5
+static const int bench_depth_counts[] = { 10000, 100000, 1000000 };
+
+//Frame the raster benchmarks draw into
+#define BENCH_FRAME_WIDTH 1920
+#define BENCH_FRAME_HEIGHT 1080
+
+//Lines of up to BENCH_LINE_LENGTH pixels per frame timed by run_line_benchmark, BENCH_LINE_RUNS frames each
+#define BENCH_LINE_COUNT 10000
+#define BENCH_LINE_LENGTH 400
+#define BENCH_LINE_RUNS 5
+
+//Circle radii timed by run_ellipse_benchmark, each drawn often enough to cover about BENCH_ELLIPSE_PIXELS unclipped
+#define BENCH_ELLIPSE_PIXELS 200000000.0
+#define BENCH_ELLIPSE_MAX_DRAWS 1000000
+static const float bench_ellipse_radii[] = { 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000 };
+
+static double seconds_since(uint64_t start) {
+    return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+int run_instance_benchmark(void) {
+    projection_t projection = {.scaling_factor = 1000, .camera_z = -5, .center_x = 960, .center_y = 540 };
+    light_t light = {.direction = {.x = 0.36f, .y = 0.48f, .z = 0.8f }, .ambient = 0.25f };
+    const mesh_t* mesh = &triangular_pyramid_mesh;
+    compute_mesh_bounds(&triangular_pyramid_mesh);
+    compute_mesh_normals(&triangular_pyramid_mesh);
+    arena_t arena;
+    cull_stats_t stats = { 0 };
+    arena_init(&arena, FRAME_ARENA_SIZE);
+    init_instance_workers();
+
+    int max_instances = bench_instance_counts[sizeof(bench_instance_counts) / sizeof(bench_instance_counts[0]) - 1];
+    int capacity = max_instances * mesh->n_faces * MAX_CLIPPED_TRIANGLES;
+    instance_t* instances = (instance_t*)malloc(max_instances * sizeof(instance_t));
+    triangle_t* triangles = (triangle_t*)malloc(capacity * sizeof(triangle_t));
+    if (!instances || !triangles) {
+        fprintf(stderr, "run_instance_benchmark() could not allocate %d instances\n", max_instances);
+        free(instances);
+        free(triangles);
+        free_instance_workers();
+        arena_free(&arena);
+        return 1;
+    }
+
+    //A block of small pyramids filling the view, every one of them on screen
+    srand(1);
+    for (int i = 0; i < max_instances; i++) {
+        instance_t instance = {
+            .scaling = {.x = 0.05f, .y = 0.05f, .z = 0.05f },
+            .rotation = {.x = (rand() % 628) / 100.0f, .y = (rand() % 628) / 100.0f, .z = (rand() % 628) / 100.0f },
+            .translation = {.x = (rand() % 2000 - 1000) / 10.0f, .y = (rand() % 1000 - 500) / 10.0f, .z = 100 + rand() % 100 },
+            .color = 0x00FF00
+        };
+        instances[i] = instance;
+    }
+
+    printf("%s, %d faces, lit\n", "triangular pyramid", mesh->n_faces);
+    printf("instances  batched inst/s  single inst/s  triangles\n");
+    for (size_t c = 0; c < sizeof(bench_instance_counts) / sizeof(bench_instance_counts[0]); c++) {
+        int n_instances = bench_instance_counts[c];
+        int batch_capacity = n_instances * mesh->n_faces * MAX_CLIPPED_TRIANGLES;
+        int written = 0;
+
+        uint64_t start = SDL_GetPerformanceCounter();
+        for (int run = 0; run < BENCH_INSTANCE_RUNS; run++) {
+            written = project_mesh_instances(mesh, instances, n_instances, projection, &light, triangles, batch_capacity, &arena, &stats);
+            arena_reset(&arena);
+        }
+        double batched = seconds_since(start) / BENCH_INSTANCE_RUNS;
+
+        //The way the scene projected its meshes before instancing, it has to keep the same triangles
+        int single_written = 0;
+        start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < n_instances; i++) {
+            single_written += project_mesh_instances(mesh, &instances[i], 1, projection, &light, triangles, mesh->n_faces * MAX_CLIPPED_TRIANGLES, &arena, &stats);
+            if (i % 1024 == 1023) {
+                arena_reset(&arena);
+            }
+        }
+        double single = seconds_since(start);
+        arena_reset(&arena);
+
+        printf("%9d  %14.0f  %13.0f  %9d\n", n_instances, n_instances / batched, n_instances / single, written);
+        if (single_written != written) {
+            fprintf(stderr, "Batched projection wrote %d triangles, one at a time %d\n", written, single_written);
+        }
+    }
+
+    free(instances);
+    free(triangles);
+    free_instance_workers();
+    arena_free(&arena);
+    return 0;
+}
+
+//Farthest first, ties in list order like the radix sort. Faces point into one array, so its order is the list order
+static int compare_face_depth(const void* a, const void* b) {
+    const triangle_t* face_a = *(const triangle_t* const*)a;
+    const triangle_t* face_b = *(const triangle_t* const*)b;
+    if (face_a->depth != face_b->depth) {
+        return face_a->depth > face_b->depth ? -1 : 1;
+    }
+    return face_a < face_b ? -1 : face_a > face_b;
+}
+
+int run_depth_benchmark(void) {
+    int max_faces = bench_depth_counts[sizeof(bench_depth_counts) / sizeof(bench_depth_counts[0]) - 1];
+    triangle_t* faces = (triangle_t*)calloc(max_faces, sizeof(triangle_t));
+    const triangle_t** sorted = (const triangle_t**)malloc(max_faces * sizeof(*sorted));
+    depth_list_t list = { 0 };
+    if (!faces || !sorted) {
+        fprintf(stderr, "run_depth_benchmark() could not allocate %d faces\n", max_faces);
+        free(faces);
+        free((void*)sorted);
+        return 1;
+    }
+
+    //Spread over the depths the scene projects to, with repeats so ties are sorted too
+    srand(1);
+    for (int i = 0; i < max_faces; i++) {
+        faces[i].depth = 5 + (rand() % 20000) / 100.0f;
+    }
+
+    printf("faces      radix ms  qsort ms  speedup\n");
+    int status = 0;
+    for (size_t c = 0; c < sizeof(bench_depth_counts) / sizeof(bench_depth_counts[0]); c++) {
+        int n_faces = bench_depth_counts[c];
+
+        //Both sorts start from the faces in projection order every run, only the sorting is timed
+        double radix = 0;
+        for (int run = 0; run < BENCH_DEPTH_RUNS; run++) {
+            reset_depth_list(&list);
+            if (!add_depth_faces(&list, faces, n_faces)) {
+                fprintf(stderr, "run_depth_benchmark() could not grow the depth list to %d faces\n", n_faces);
+                status = 1;
+                break;
+            }
+            uint64_t start = SDL_GetPerformanceCounter();
+            sort_depth_list(&list);
+            radix += seconds_since(start);
+        }
+        if (status != 0) {
+            break;
+        }
+
+        double quick = 0;
+        for (int run = 0; run < BENCH_DEPTH_RUNS; run++) {
+            for (int i = 0; i < n_faces; i++) {
+                sorted[i] = &faces[i];
+            }
+            uint64_t start = SDL_GetPerformanceCounter();
+            qsort((void*)sorted, n_faces, sizeof(*sorted), compare_face_depth);
+            quick += seconds_since(start);
+        }
+
+        printf("%7d  %10.2f  %8.2f  %6.2fx\n", n_faces, 1000 * radix / BENCH_DEPTH_RUNS, 1000 * quick / BENCH_DEPTH_RUNS, quick / radix);
+        if (memcmp((const void*)list.faces, (const void*)sorted, n_faces * sizeof(*sorted)) != 0) {
+            fprintf(stderr, "Radix and qsort orders differ at %d faces\n", n_faces);
+            status = 1;
+        }
+    }
+
+    free_depth_list(&list);
+    free(faces);
+    free((void*)sorted);
+    return status;
+}
+
+//Box filter of every 2x2 block of the supersampled surface down to one pixel of out
+static void resolve_2x2(const uint32_t* samples, int width, int height, uint32_t* out) {
+    int sample_width = 2 * width;
+    for (int y = 0; y < height; y++) {
+        const uint32_t* top = samples + 2 * y * sample_width;
+        const uint32_t* bottom = top + sample_width;
+        for (int x = 0; x < width; x++) {
+            uint32_t a = top[2 * x], b = top[2 * x + 1], c = bottom[2 * x], d = bottom[2 * x + 1];
+
+            //Red and blue, then alpha and green, two channels per add with room for the carry
+            uint32_t rb = ((a & 0x00FF00FF) + (b & 0x00FF00FF) + (c & 0x00FF00FF) + (d & 0x00FF00FF)) >> 2;
+            uint32_t ag = ((a >> 8 & 0x00FF00FF) + (b >> 8 & 0x00FF00FF) + (c >> 8 & 0x00FF00FF) + (d >> 8 & 0x00FF00FF)) >> 2;
+            out[y * width + x] = (rb & 0x00FF00FF) | (ag & 0x00FF00FF) << 8;
+        }
+    }
+}
+
+typedef enum {
+    BENCH_LINES_ALIASED,
+    BENCH_LINES_WU,
+    BENCH_LINES_SSAA,
+    N_BENCH_LINE_MODES
+} bench_line_mode_t;
+
+static const char* bench_line_mode_names[N_BENCH_LINE_MODES] = { "aliased", "Wu AA", "2x2 SSAA" };
+
+//One frame: clear, every line, and for SSAA the resolve down to the frame
+static void draw_line_frame(bench_line_mode_t mode, const int* lines, uint32_t* frame, uint32_t* samples) {
+    framebuffer_t framebuffer = { frame, BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, mode == BENCH_LINES_WU };
+    framebuffer_t supersampled = { samples, 2 * BENCH_FRAME_WIDTH, 2 * BENCH_FRAME_HEIGHT };
+    framebuffer_t* target = mode == BENCH_LINES_SSAA ? &supersampled : &framebuffer;
+    int scale = mode == BENCH_LINES_SSAA ? 2 : 1;
+
+    raster_clear(target, 0xFF000000);
+    for (int i = 0; i < BENCH_LINE_COUNT; i++) {
+        const int* line = lines + 5 * i;
+        raster_line(target, scale * line[0], scale * line[1], scale * line[2], scale * line[3], (uint32_t)line[4]);
+    }
+    if (mode == BENCH_LINES_SSAA) {
+        resolve_2x2(samples, BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, frame);
+    }
+}
+
+int run_line_benchmark(void) {
+    size_t frame_pixels = (size_t)BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT;
+    uint32_t* frame = (uint32_t*)malloc(frame_pixels * sizeof(uint32_t));
+    uint32_t* samples = (uint32_t*)malloc(4 * frame_pixels * sizeof(uint32_t));
+    int* lines = (int*)malloc(5 * BENCH_LINE_COUNT * sizeof(int));
+    if (!frame || !samples || !lines) {
+        fprintf(stderr, "run_line_benchmark() could not allocate a %dx%d frame\n", BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT);
+        free(frame);
+        free(samples);
+        free(lines);
+        return 1;
+    }
+
+    //x0, y0, x1, y1, color. Every direction and slope, some of them running off the frame
+    srand(1);
+    for (int i = 0; i < BENCH_LINE_COUNT; i++) {
+        int* line = lines + 5 * i;
+        line[0] = rand() % BENCH_FRAME_WIDTH;
+        line[1] = rand() % BENCH_FRAME_HEIGHT;
+        line[2] = line[0] + rand() % (2 * BENCH_LINE_LENGTH + 1) - BENCH_LINE_LENGTH;
+        line[3] = line[1] + rand() % (2 * BENCH_LINE_LENGTH + 1) - BENCH_LINE_LENGTH;
+        line[4] = (int)(0xFF000000 | (rand() % 256) << 16 | (rand() % 256) << 8 | rand() % 256);
+    }
+
+    printf("%d lines of up to %d pixels at %dx%d\n", BENCH_LINE_COUNT, BENCH_LINE_LENGTH, BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT);
+    printf("mode       ms/frame  Mlines/s  vs aliased\n");
+    double aliased = 0;
+    for (int mode = 0; mode < N_BENCH_LINE_MODES; mode++) {
+        //Untimed first frame, so every mode starts with its buffers paged in
+        draw_line_frame((bench_line_mode_t)mode, lines, frame, samples);
+
+        uint64_t start = SDL_GetPerformanceCounter();
+        for (int run = 0; run < BENCH_LINE_RUNS; run++) {
+            draw_line_frame((bench_line_mode_t)mode, lines, frame, samples);
+        }
+        double seconds = seconds_since(start) / BENCH_LINE_RUNS;
+        if (mode == BENCH_LINES_ALIASED) {
+            aliased = seconds;
+        }
+        printf("%-9s  %8.2f  %8.2f  %9.2fx\n", bench_line_mode_names[mode], 1000 * seconds, BENCH_LINE_COUNT / seconds / 1e6, seconds / aliased);
+    }
+
+    free(frame);
+    free(samples);
+    free(lines);
+    return 0;
+}
+
+int run_ellipse_benchmark(void) {
+    size_t frame_pixels = (size_t)BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT;
+    uint32_t* frame = (uint32_t*)malloc(frame_pixels * sizeof(uint32_t));
+    if (!frame) {
+        fprintf(stderr, "run_ellipse_benchmark() could not allocate a %dx%d frame\n", BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT);
+        return 1;
+    }
+    framebuffer_t framebuffer = { frame, BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT };
+    raster_clear(&framebuffer, 0xFF000000);
+
+    printf("Filled circles at %dx%d, centers anywhere in the frame\n", BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT);
+    printf("radius      draws  ellipses/s  Mpixels/s  pixels/ellipse\n");
+    for (size_t r = 0; r < sizeof(bench_ellipse_radii) / sizeof(bench_ellipse_radii[0]); r++) {
+        float radius = bench_ellipse_radii[r];
+        double area = 3.14159265 * radius * radius;
+        int draws = (int)(BENCH_ELLIPSE_PIXELS / area);
+        draws = draws < 16 ? 16 : draws > BENCH_ELLIPSE_MAX_DRAWS ? BENCH_ELLIPSE_MAX_DRAWS : draws;
+
+        //Fractional centers, the same sequence for every radius. Whole pixel and fraction are drawn
+        //separately, RAND_MAX may be as low as 32767
+        srand(1);
+        framebuffer.pixels_written = 0;
+        uint64_t start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < draws; i++) {
+            float x = rand() % BENCH_FRAME_WIDTH + (rand() % 100) / 100.0f;
+            float y = rand() % BENCH_FRAME_HEIGHT + (rand() % 100) / 100.0f;
+            raster_fill_ellipse(&framebuffer, x, y, radius, radius, 0xFF000000 | (uint32_t)i * 2654435761u >> 8);
+        }
+        double seconds = seconds_since(start);
+
+        printf("%6.0f  %9d  %10.0f  %9.1f  %14.0f\n", radius, draws, draws / seconds,
+            framebuffer.pixels_written / seconds / 1e6, (double)framebuffer.pixels_written / draws);
+    }
+
+    free(frame);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+//Command line benchmarks of the modules on their own, no window needed. Each prints a table and
+//returns the process exit code
+
+//Instances per second through project_mesh_instances, batched and one call per instance
+int run_instance_benchmark(void);
+
+//sort_depth_list's radix sort against qsort on the same faces, up to a million
+int run_depth_benchmark(void);
+
+//Frames of random lines aliased, with raster_line_aa and aliased at 2x2 supersampling, resolve included
+int run_line_benchmark(void);
+
+//Fill rate of raster_fill_ellipse from radius 2 to 2000, the large ones clipped by the frame
+int run_ellipse_benchmark(void);
+
+#endif
@@ -0,0 +1,375 @@
+#include "command.h"
+#include "depth.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+static bool grow(void** items, int* capacity, int needed, size_t item_size) {
+    if (needed <= *capacity) {
+        return true;
+    }
+    int new_capacity = *capacity > 0 ? *capacity : 256;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    void* grown = realloc(*items, new_capacity * item_size);
+    if (!grown) {
+        return false;
+    }
+    *items = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+static uint16_t command_tile(int min_x, int min_y) {
+    int tile_x = min_x < 0 ? 0 : min_x / COMMAND_TILE_SIZE;
+    int tile_y = min_y < 0 ? 0 : min_y / COMMAND_TILE_SIZE;
+    tile_x = tile_x > 255 ? 255 : tile_x;
+    tile_y = tile_y > 255 ? 255 : tile_y;
+    return (uint16_t)((tile_y << 8) | tile_x);
+}
+
+static draw_command_t* append_command(command_buffer_t* buffer, command_type_t type, int min_x, int min_y, uint32_t color) {
+    if (!grow((void**)&buffer->commands, &buffer->capacity, buffer->count + 1, sizeof(draw_command_t))) {
+        return NULL;
+    }
+    draw_command_t* command = &buffer->commands[buffer->count++];
+
+    //Unused union bytes must compare equal in command_buffers_equal()
+    memset(command, 0, sizeof(*command));
+    command->type = (uint8_t)type;
+    command->tile = command_tile(min_x, min_y);
+    command->color = color;
+    return command;
+}
+
+//One row of slack either side covers rounding and anti-aliased edges
+static void cover_rows(command_buffer_t* buffer, int top, int bottom) {
+    top -= 1;
+    bottom += 2;
+    if (buffer->top >= buffer->bottom) {
+        buffer->top = top;
+        buffer->bottom = bottom;
+        return;
+    }
+    buffer->top = top < buffer->top ? top : buffer->top;
+    buffer->bottom = bottom > buffer->bottom ? bottom : buffer->bottom;
+}
+
+void reset_command_buffer(command_buffer_t* buffer, uint32_t clear_color) {
+    buffer->count = 0;
+    buffer->n_points = 0;
+    buffer->clear_color = clear_color;
+    buffer->top = 0;
+    buffer->bottom = 0;
+}
+
+void free_command_buffer(command_buffer_t* buffer) {
+    free(buffer->commands);
+    free(buffer->points);
+    free(buffer->sort_keys);
+    free((void*)buffer->sorted);
+    free(buffer->scratch_keys);
+    free((void*)buffer->scratch_sorted);
+    command_buffer_t empty = { 0 };
+    *buffer = empty;
+}
+
+void record_pixel(command_buffer_t* buffer, int x, int y, uint32_t color) {
+    draw_command_t* command = append_command(buffer, COMMAND_PIXEL, x, y, color);
+    if (command) {
+        command->pixel.x = x;
+        command->pixel.y = y;
+        cover_rows(buffer, y, y);
+    }
+}
+
+void record_line(command_buffer_t* buffer, int x0, int y0, int x1, int y1, uint32_t color) {
+    draw_command_t* command = append_command(buffer, COMMAND_LINE, x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1, color);
+    if (command) {
+        command->line.x0 = x0;
+        command->line.y0 = y0;
+        command->line.x1 = x1;
+        command->line.y1 = y1;
+        cover_rows(buffer, y0 < y1 ? y0 : y1, y0 > y1 ? y0 : y1);
+    }
+}
+
+void record_rect(command_buffer_t* buffer, int x, int y, int width, int height, const uint32_t side_colors[4]) {
+    draw_command_t* command = append_command(buffer, COMMAND_RECT, x, y, side_colors[0]);
+    if (command) {
+        command->rect.x = x;
+        command->rect.y = y;
+        command->rect.width = width;
+        command->rect.height = height;
+        for (int i = 0; i < 4; i++) {
+            command->rect.side_colors[i] = side_colors[i];
+        }
+        cover_rows(buffer, height < 0 ? y + height : y, height < 0 ? y : y + height);
+    }
+}
+
+void record_ellipse(command_buffer_t* buffer, float x, float y, float radius_x, float radius_y, bool filled, uint32_t color) {
+    command_type_t type = filled ? COMMAND_FILLED_ELLIPSE : COMMAND_ELLIPSE;
+    draw_command_t* command = append_command(buffer, type, (int)(x - radius_x), (int)(y - radius_y), color);
+    if (command) {
+        command->ellipse.x = x;
+        command->ellipse.y = y;
+        command->ellipse.radius_x = radius_x;
+        command->ellipse.radius_y = radius_y;
+        cover_rows(buffer, (int)floorf(y - radius_y), (int)ceilf(y + radius_y));
+    }
+}
+
+static void record_triangle_of_type(command_buffer_t* buffer, command_type_t type, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color) {
+    int min_x = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+    int min_y = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+
+    draw_command_t* command = append_command(buffer, type, min_x, min_y, color);
+    if (command) {
+        command->triangle.x0 = x0;
+        command->triangle.y0 = y0;
+        command->triangle.x1 = x1;
+        command->triangle.y1 = y1;
+        command->triangle.x2 = x2;
+        command->triangle.y2 = y2;
+        cover_rows(buffer, y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2), y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2));
+    }
+}
+
+void record_triangle(command_buffer_t* buffer, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color) {
+    record_triangle_of_type(buffer, COMMAND_TRIANGLE, x0, y0, x1, y1, x2, y2, color);
+}
+
+void record_filled_triangle(command_buffer_t* buffer, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color) {
+    record_triangle_of_type(buffer, COMMAND_FILLED_TRIANGLE, x0, y0, x1, y1, x2, y2, color);
+}
+
+void record_face(command_buffer_t* buffer, int x0, int y0, int x1, int y1, int x2, int y2, int outline_edges, uint32_t color) {
+    draw_command_t* command = append_command(buffer, COMMAND_FACE, 0, 0, color);
+    if (command) {
+        command->face.x0 = x0;
+        command->face.y0 = y0;
+        command->face.x1 = x1;
+        command->face.y1 = y1;
+        command->face.x2 = x2;
+        command->face.y2 = y2;
+        command->face.outline_edges = outline_edges;
+        cover_rows(buffer, y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2), y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2));
+    }
+}
+
+void record_star(command_buffer_t* buffer, int x, int y, int size, float angle, uint32_t color) {
+    draw_command_t* command = append_command(buffer, COMMAND_STAR, x - size, y - size, color);
+    if (command) {
+        command->star.x = x;
+        command->star.y = y;
+        command->star.size = size;
+        command->star.angle = angle;
+        cover_rows(buffer, y - size, y + size);
+    }
+}
+
+void record_polygons(command_buffer_t* buffer, const polygon_t* polygons, int n_polygons, polygon_mode_t mode) {
+    int total_points = 0;
+    for (int p = 0; p < n_polygons; p++) {
+        total_points += polygons[p].n_points > 0 ? polygons[p].n_points : 0;
+    }
+    if (!grow((void**)&buffer->points, &buffer->points_capacity, buffer->n_points + total_points, sizeof(vec2_t))) {
+        return;
+    }
+
+    command_type_t type = mode == POLYGON_FILLED ? COMMAND_FILLED_POLYGON : COMMAND_POLYGON;
+    for (int p = 0; p < n_polygons; p++) {
+        const polygon_t* polygon = &polygons[p];
+        if (polygon->n_points <= 0) {
+            continue;
+        }
+
+        float min_x = polygon->points[0].x, min_y = polygon->points[0].y, max_y = min_y;
+        for (int i = 1; i < polygon->n_points; i++) {
+            min_x = polygon->points[i].x < min_x ? polygon->points[i].x : min_x;
+            min_y = polygon->points[i].y < min_y ? polygon->points[i].y : min_y;
+            max_y = polygon->points[i].y > max_y ? polygon->points[i].y : max_y;
+        }
+
+        draw_command_t* command = append_command(buffer, type, (int)(min_x + polygon->offset.x), (int)(min_y + polygon->offset.y), polygon->color);
+        if (!command) {
+            return;
+        }
+        command->polygon.first_point = buffer->n_points;
+        command->polygon.n_points = polygon->n_points;
+        command->polygon.closed = mode != POLYGON_POLYLINE;
+        cover_rows(buffer, (int)floorf(min_y + polygon->offset.y), (int)ceilf(max_y + polygon->offset.y));
+        for (int i = 0; i < polygon->n_points; i++) {
+            vec2_t point = {
+                .x = polygon->points[i].x + polygon->offset.x,
+                .y = polygon->points[i].y + polygon->offset.y
+            };
+            buffer->points[buffer->n_points++] = point;
+        }
+    }
+}
+
+//Nothing is kept between sorts, so the arrays are replaced rather than copied
+static bool grow_sort_buffers(command_buffer_t* buffer) {
+    if (buffer->count <= buffer->keys_capacity) {
+        return true;
+    }
+    int new_capacity = buffer->keys_capacity > 0 ? buffer->keys_capacity : 256;
+    while (new_capacity < buffer->count) {
+        new_capacity *= 2;
+    }
+
+    free(buffer->sort_keys);
+    free((void*)buffer->sorted);
+    free(buffer->scratch_keys);
+    free((void*)buffer->scratch_sorted);
+    buffer->sort_keys = (uint32_t*)malloc(new_capacity * sizeof(uint32_t));
+    buffer->sorted = (const void**)malloc(new_capacity * sizeof(void*));
+    buffer->scratch_keys = (uint32_t*)malloc(new_capacity * sizeof(uint32_t));
+    buffer->scratch_sorted = (const void**)malloc(new_capacity * sizeof(void*));
+    if (!buffer->sort_keys || !buffer->sorted || !buffer->scratch_keys || !buffer->scratch_sorted) {
+        buffer->keys_capacity = 0;
+        return false;
+    }
+    buffer->keys_capacity = new_capacity;
+    return true;
+}
+
+//The type switch happens once per batch, not once per command
+static void execute_batch(const command_buffer_t* buffer, framebuffer_t* framebuffer, command_type_t type, const draw_command_t* const* commands, int count) {
+    switch (type) {
+    case COMMAND_FACE:
+        for (int k = 0; k < count; k++) {
+            const draw_command_t* command = commands[k];
+            int x[3] = { command->face.x0, command->face.x1, command->face.x2 };
+            int y[3] = { command->face.y0, command->face.y1, command->face.y2 };
+            if (command->face.outline_edges == 0) {
+                raster_fill_triangle(framebuffer, x[0], y[0], x[1], y[1], x[2], y[2], command->color);
+                continue;
+            }
+            for (int i = 0; i < 3; i++) {
+                if (command->face.outline_edges & (1 << i)) {
+                    raster_line(framebuffer, x[i], y[i], x[(i + 1) % 3], y[(i + 1) % 3], command->color);
+                }
+            }
+        }
+        break;
+    case COMMAND_FILLED_TRIANGLE:
+        for (int k = 0; k < count; k++) {
+            const draw_command_t* command = commands[k];
+            raster_fill_triangle(framebuffer, command->triangle.x0, command->triangle.y0, command->triangle.x1, command->triangle.y1,
+                command->triangle.x2, command->triangle.y2, command->color);
+        }
+        break;
+    case COMMAND_FILLED_POLYGON:
+        for (int k = 0; k < count; k++) {
+            const draw_command_t* command = commands[k];
+            raster_fill_polygon(framebuffer, buffer->points + command->polygon.first_point, command->polygon.n_points, command->color);
+        }
+        break;
+    case COMMAND_FILLED_ELLIPSE:
+        for (int k = 0; k < count; k++) {
+            const draw_command_t* command = commands[k];
+            raster_fill_ellipse(framebuffer, command->ellipse.x, command->ellipse.y, command->ellipse.radius_x, command->ellipse.radius_y, command->color);
+        }
+        break;
+    case COMMAND_PIXEL:
+        for (int k = 0; k < count; k++) {
+            const draw_command_t* command = commands[k];
+            raster_pixel(framebuffer, command->pixel.x, command->pixel.y, command->color);
+        }
+        break;
+    case COMMAND_LINE:
+        for (int k = 0; k < count; k++) {
+            const draw_command_t* command = commands[k];
+            raster_line(framebuffer, command->line.x0, command->line.y0, command->line.x1, command->line.y1, command->color);
+        }
+        break;
+    case COMMAND_RECT:
+        for (int k = 0; k < count; k++) {
+            const draw_command_t* command = commands[k];
+            raster_rect(framebuffer, command->rect.x, command->rect.y, command->rect.width, command->rect.height, command->rect.side_colors);
+        }
+        break;
+    case COMMAND_ELLIPSE:
+        for (int k = 0; k < count; k++) {
+            const draw_command_t* command = commands[k];
+            raster_ellipse(framebuffer, command->ellipse.x, command->ellipse.y, command->ellipse.radius_x, command->ellipse.radius_y, command->color);
+        }
+        break;
+    case COMMAND_TRIANGLE:
+        for (int k = 0; k < count; k++) {
+            const draw_command_t* command = commands[k];
+            raster_triangle(framebuffer, command->triangle.x0, command->triangle.y0, command->triangle.x1, command->triangle.y1,
+                command->triangle.x2, command->triangle.y2, command->color);
+        }
+        break;
+    case COMMAND_STAR:
+        for (int k = 0; k < count; k++) {
+            const draw_command_t* command = commands[k];
+            raster_star(framebuffer, command->star.x, command->star.y, command->star.size, command->star.angle, command->color);
+        }
+        break;
+    case COMMAND_POLYGON:
+        for (int k = 0; k < count; k++) {
+            const draw_command_t* command = commands[k];
+            const vec2_t* points = buffer->points + command->polygon.first_point;
+            if (command->polygon.closed) {
+                raster_polygon(framebuffer, points, command->polygon.n_points, command->color);
+            }
+            else {
+                raster_polyline(framebuffer, points, command->polygon.n_points, command->color);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void draw_command_buffer(command_buffer_t* buffer, framebuffer_t* framebuffer) {
+    if (buffer->count == 0 || !grow_sort_buffers(buffer)) {
+        return;
+    }
+
+    //type | tile, sorted stably so equal keys keep their recording order. Pixels in the same place share
+    //a tile, every other type may overlap across tiles and keeps tile 0
+    for (int i = 0; i < buffer->count; i++) {
+        const draw_command_t* command = &buffer->commands[i];
+        uint32_t tile = command->type == COMMAND_PIXEL ? command->tile : 0;
+        buffer->sort_keys[i] = ((uint32_t)command->type << 16) | tile;
+        buffer->sorted[i] = command;
+    }
+    radix_sort_keys(buffer->sort_keys, buffer->sorted, buffer->scratch_keys, buffer->scratch_sorted, buffer->count);
+
+    //One dispatch per run of the same type
+    const draw_command_t* const* sorted = (const draw_command_t* const*)buffer->sorted;
+    int begin = 0;
+    while (begin < buffer->count) {
+        command_type_t type = (command_type_t)(buffer->sort_keys[begin] >> 16);
+        int end = begin;
+        while (end < buffer->count && (command_type_t)(buffer->sort_keys[end] >> 16) == type) {
+            end++;
+        }
+        execute_batch(buffer, framebuffer, type, sorted + begin, end - begin);
+        begin = end;
+    }
+}
+
+void execute_command_buffer(command_buffer_t* buffer, framebuffer_t* framebuffer) {
+    raster_clear(framebuffer, buffer->clear_color);
+    draw_command_buffer(buffer, framebuffer);
+}
+
+bool command_buffers_equal(const command_buffer_t* a, const command_buffer_t* b) {
+    if (a->count != b->count || a->n_points != b->n_points) {
+        return false;
+    }
+    if (a->count > 0 && memcmp(a->commands, b->commands, a->count * sizeof(draw_command_t)) != 0) {
+        return false;
+    }
+    return a->n_points == 0 || memcmp(a->points, b->points, a->n_points * sizeof(vec2_t)) == 0;
+}
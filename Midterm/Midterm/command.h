@@ -0,0 +1,105 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "vector.h"
+#include "raster.h"
+
+//Screen tiles pixels are sorted by after their type
+#define COMMAND_TILE_SIZE 128
+
+//Also the draw order of the batches, fills go under every outline.
+//Mesh faces come first and are one batch whether filled or outlined, so their depth order holds
+typedef enum {
+    COMMAND_FACE,
+    COMMAND_FILLED_TRIANGLE,
+    COMMAND_FILLED_POLYGON,
+    COMMAND_FILLED_ELLIPSE,
+    COMMAND_PIXEL,
+    COMMAND_LINE,
+    COMMAND_RECT,
+    COMMAND_ELLIPSE,
+    COMMAND_TRIANGLE,
+    COMMAND_STAR,
+    COMMAND_POLYGON,
+    N_COMMAND_TYPES
+} command_type_t;
+
+typedef struct {
+    uint8_t type;
+    uint16_t tile;
+    uint32_t color;
+    union {
+        struct { int x, y; } pixel;
+        struct { int x0, y0, x1, y1; } line;
+        struct { int x, y, width, height; uint32_t side_colors[4]; } rect;
+        struct { float x, y, radius_x, radius_y; } ellipse; //also filled ellipses
+        struct { int x0, y0, x1, y1, x2, y2; } triangle; //also filled triangles
+        struct { int x0, y0, x1, y1, x2, y2; int outline_edges; } face; //filled when outline_edges is 0
+        struct { int x, y, size; float angle; } star;
+        struct { int first_point, n_points; bool closed; } polygon; //range of command_buffer_t.points, also filled polygons
+    };
+} draw_command_t;
+
+typedef enum {
+    POLYGON_OUTLINE,
+    POLYGON_FILLED,
+    POLYGON_POLYLINE //outline left open between the last and first point
+} polygon_mode_t;
+
+//One polygon of a batch. Instances can share points, each is placed by its own offset
+typedef struct {
+    const vec2_t* points;
+    int n_points;
+    vec2_t offset;
+    uint32_t color;
+} polygon_t;
+
+//Grows to the busiest frame and is then reused, replaying it never allocates
+typedef struct {
+    draw_command_t* commands;
+    int count;
+    int capacity;
+    vec2_t* points;
+    int n_points;
+    int points_capacity;
+    uint32_t* sort_keys; //sort scratch, everything below has keys_capacity entries
+    const void** sorted;
+    uint32_t* scratch_keys;
+    const void** scratch_sorted;
+    int keys_capacity;
+    uint32_t clear_color;
+    int top; //rows the commands can touch, bottom excluded. Empty while top >= bottom
+    int bottom;
+} command_buffer_t;
+
+//Drops everything recorded so far, execution starts by filling clear_color
+void reset_command_buffer(command_buffer_t* buffer, uint32_t clear_color);
+void free_command_buffer(command_buffer_t* buffer);
+
+void record_pixel(command_buffer_t* buffer, int x, int y, uint32_t color);
+void record_line(command_buffer_t* buffer, int x0, int y0, int x1, int y1, uint32_t color);
+void record_rect(command_buffer_t* buffer, int x, int y, int width, int height, const uint32_t side_colors[4]);
+void record_ellipse(command_buffer_t* buffer, float x, float y, float radius_x, float radius_y, bool filled, uint32_t color);
+void record_triangle(command_buffer_t* buffer, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color);
+//Fills keep their recording order, callers paint them back to front
+void record_filled_triangle(command_buffer_t* buffer, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color);
+//Depth sorted mesh face in recording order. outline_edges 0 fills it, otherwise only the edges
+//set in the mask are drawn (bit i from point i to point (i + 1) % 3)
+void record_face(command_buffer_t* buffer, int x0, int y0, int x1, int y1, int x2, int y2, int outline_edges, uint32_t color);
+void record_star(command_buffer_t* buffer, int x, int y, int size, float angle, uint32_t color);
+//The whole batch in one call, points are copied already offset
+void record_polygons(command_buffer_t* buffer, const polygon_t* polygons, int n_polygons, polygon_mode_t mode);
+
+//Sorts by type and rasterizes one batch per type. Within a type the recording order is kept, so
+//overlapping draws paint in the order they were made. Only pixels, which cannot overlap across tiles,
+//are grouped by tile first. The buffer is left untouched, so it can be executed again
+void draw_command_buffer(command_buffer_t* buffer, framebuffer_t* framebuffer);
+
+//Fills clear_color first
+void execute_command_buffer(command_buffer_t* buffer, framebuffer_t* framebuffer);
+
+//Same commands in the same order
+bool command_buffers_equal(const command_buffer_t* a, const command_buffer_t* b);
+
+#endif
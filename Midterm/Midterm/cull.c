@@ -0,0 +1,59 @@
+#include "cull.h"
+#include <math.h>
+
+cull_stats_t cull_stats = { 0 };
+
+void reset_cull_stats(cull_stats_t* stats) {
+    cull_stats_t empty = { 0 };
+    *stats = empty;
+}
+
+static bool screen_rect_outside(int min_x, int min_y, int max_x, int max_y, int width, int height) {
+    return max_x < 0 || max_y < 0 || min_x >= width || min_y >= height;
+}
+
+bool cull_screen_object(cull_stats_t* stats, int min_x, int min_y, int max_x, int max_y, int width, int height) {
+    stats->objects_tested++;
+    if (screen_rect_outside(min_x, min_y, max_x, max_y, width, height)) {
+        stats->objects_culled++;
+        return true;
+    }
+    return false;
+}
+
+bool cull_screen_primitive(cull_stats_t* stats, int min_x, int min_y, int max_x, int max_y, int width, int height) {
+    stats->primitives_tested++;
+    if (screen_rect_outside(min_x, min_y, max_x, max_y, width, height)) {
+        stats->primitives_culled++;
+        return true;
+    }
+    return false;
+}
+
+bool sphere_outside_frustum(vec3_t center, float radius, projection_t projection) {
+    //Near plane
+    if (center.z + radius < NEAR_PLANE_Z) {
+        return true;
+    }
+
+    //Side planes from screen_x = f * x / z + cx staying inside [0, 2 * cx]
+    float f = projection.scaling_factor;
+    float cx = projection.center_x;
+    float cy = projection.center_y;
+    float length_x = sqrtf(f * f + cx * cx);
+    float length_y = sqrtf(f * f + cy * cy);
+
+    if (f * center.x + cx * center.z < -radius * length_x) {
+        return true; //left
+    }
+    if (-f * center.x + cx * center.z < -radius * length_x) {
+        return true; //right
+    }
+    if (f * center.y + cy * center.z < -radius * length_y) {
+        return true; //top
+    }
+    if (-f * center.y + cy * center.z < -radius * length_y) {
+        return true; //bottom
+    }
+    return false;
+}
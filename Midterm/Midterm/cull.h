@@ -0,0 +1,31 @@
+#ifndef CULL_H
+#define CULL_H
+#include <stdbool.h>
+#include "vector.h"
+#include "instance.h"
+
+//View-space z below which geometry is behind the camera
+#define NEAR_PLANE_Z 0.1f
+
+typedef struct cull_stats {
+    int objects_tested;
+    int objects_culled;
+    int primitives_tested;
+    int primitives_culled;
+    int primitives_clipped; //faces that crossed the near or guard-band planes
+    int primitives_backfaced; //lit faces turned away from the camera, also counted as culled
+} cull_stats_t;
+
+//Counters of the last frame the live loop recorded, shown on the HUD
+extern cull_stats_t cull_stats;
+
+void reset_cull_stats(cull_stats_t* stats);
+
+//Both return true when the box lies completely outside the screen, and count the test in stats
+bool cull_screen_object(cull_stats_t* stats, int min_x, int min_y, int max_x, int max_y, int width, int height);
+bool cull_screen_primitive(cull_stats_t* stats, int min_x, int min_y, int max_x, int max_y, int width, int height);
+
+//Sphere in view space (camera already subtracted) against the projection's frustum
+bool sphere_outside_frustum(vec3_t center, float radius, projection_t projection);
+
+#endif
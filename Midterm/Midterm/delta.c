@@ -0,0 +1,210 @@
+#include "delta.h"
+#include <stdlib.h>
+#include <string.h>
+#include <emmintrin.h>
+
+//Per 4-pixel column of a tile row, mixed with a per-row salt so moving content changes the hash
+static __m128i column_keys[DELTA_TILE_SIZE / 4];
+static bool keys_ready = false;
+
+static uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static void build_column_keys(void) {
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < DELTA_TILE_SIZE / 4; i++) {
+        uint64_t low = mix64(state += 0x9E3779B97F4A7C15ULL);
+        uint64_t high = mix64(state += 0x9E3779B97F4A7C15ULL);
+        column_keys[i] = _mm_set_epi64x((long long)high, (long long)low);
+    }
+    keys_ready = true;
+}
+
+//Accumulates 4 pixels at a time like XXH3: each 64-bit lane adds the product of its keyed
+//halves and the neighbouring lane's raw data. Two accumulators hide the add latency
+static uint64_t hash_tile(const uint32_t* pixels, int pitch, int width, int height) {
+    __m128i acc[2] = { _mm_set_epi64x(0x60EA27EEADC0B5D6LL, 0x24234428E9E3F5C7LL), _mm_set_epi64x(0x165667B19E3779F9LL, 0x27D4EB2F165667C5LL) };
+    uint64_t tail = 0;
+    int blocks = width / 4;
+
+    for (int y = 0; y < height; y++) {
+        const uint32_t* row = pixels + (size_t)y * pitch;
+        __m128i salt = _mm_set1_epi32((int)((uint32_t)(y + 1) * 0x9E3779B1u));
+
+        for (int b = 0; b < blocks; b++) {
+            __m128i data = _mm_loadu_si128((const __m128i*)(row + b * 4));
+            __m128i keyed = _mm_xor_si128(data, _mm_xor_si128(column_keys[b], salt));
+            __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+            acc[b & 1] = _mm_add_epi64(acc[b & 1], _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2)));
+            acc[b & 1] = _mm_add_epi64(acc[b & 1], product);
+        }
+
+        //Columns past the last whole block of a clipped tile
+        for (int x = blocks * 4; x < width; x++) {
+            tail = mix64(tail ^ row[x] ^ ((uint64_t)(y * DELTA_TILE_SIZE + x) << 32));
+        }
+    }
+
+    uint64_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, acc[0]);
+    _mm_storeu_si128((__m128i*)(lanes + 2), acc[1]);
+    return mix64(mix64(lanes[0] ^ mix64(lanes[1])) ^ mix64(lanes[2] ^ mix64(lanes[3] ^ tail)));
+}
+
+bool init_tile_tracker(tile_tracker_t* tracker, int width, int height) {
+    tile_tracker_t empty = { 0 };
+    *tracker = empty;
+    if (!keys_ready) {
+        build_column_keys();
+    }
+
+    tracker->width = width;
+    tracker->height = height;
+    tracker->tiles_x = (width + DELTA_TILE_SIZE - 1) / DELTA_TILE_SIZE;
+    tracker->tiles_y = (height + DELTA_TILE_SIZE - 1) / DELTA_TILE_SIZE;
+    int n_tiles = tracker->tiles_x * tracker->tiles_y;
+    tracker->hashes = (uint64_t*)malloc(n_tiles * sizeof(uint64_t));
+    tracker->changed = (bool*)malloc(n_tiles * sizeof(bool));
+    return tracker->hashes && tracker->changed;
+}
+
+void free_tile_tracker(tile_tracker_t* tracker) {
+    free(tracker->hashes);
+    free(tracker->changed);
+    tracker->hashes = NULL;
+    tracker->changed = NULL;
+}
+
+int track_frame_tiles(tile_tracker_t* tracker, const uint32_t* pixels) {
+    int n_changed = 0;
+    for (int ty = 0; ty < tracker->tiles_y; ty++) {
+        int y = ty * DELTA_TILE_SIZE;
+        int height = tracker->height - y < DELTA_TILE_SIZE ? tracker->height - y : DELTA_TILE_SIZE;
+
+        for (int tx = 0; tx < tracker->tiles_x; tx++) {
+            int x = tx * DELTA_TILE_SIZE;
+            int width = tracker->width - x < DELTA_TILE_SIZE ? tracker->width - x : DELTA_TILE_SIZE;
+            int tile = ty * tracker->tiles_x + tx;
+
+            uint64_t hash = hash_tile(pixels + (size_t)y * tracker->width + x, tracker->width, width, height);
+            tracker->changed[tile] = !tracker->has_previous || hash != tracker->hashes[tile];
+            tracker->hashes[tile] = hash;
+            n_changed += tracker->changed[tile];
+        }
+    }
+
+    int n_tiles = tracker->tiles_x * tracker->tiles_y;
+    tracker->has_previous = true;
+    tracker->n_changed = n_changed;
+    tracker->tiles_tracked += n_tiles;
+    tracker->tiles_skipped += n_tiles - n_changed;
+    return n_changed;
+}
+
+double last_skipped_fraction(const tile_tracker_t* tracker) {
+    int n_tiles = tracker->tiles_x * tracker->tiles_y;
+    if (!tracker->has_previous || n_tiles == 0) {
+        return 0.0;
+    }
+    return (double)(n_tiles - tracker->n_changed) / n_tiles;
+}
+
+double total_skipped_fraction(const tile_tracker_t* tracker) {
+    return tracker->tiles_tracked > 0 ? (double)tracker->tiles_skipped / tracker->tiles_tracked : 0.0;
+}
+
+static uint8_t* put_u32(uint8_t* out, uint32_t value) {
+    memcpy(out, &value, sizeof(value));
+    return out + sizeof(value);
+}
+
+bool open_delta_writer(delta_writer_t* writer, const char* path, int width, int height) {
+    delta_writer_t empty = { 0 };
+    *writer = empty;
+    if (!init_tile_tracker(&writer->tiles, width, height)) {
+        free_tile_tracker(&writer->tiles);
+        return false;
+    }
+
+    //Every tile as pixels, each behind a one-tile repeat, is the worst case
+    int n_tiles = writer->tiles.tiles_x * writer->tiles.tiles_y;
+    writer->records_capacity = sizeof(uint32_t) + (size_t)n_tiles * 4 + (size_t)width * height * sizeof(uint32_t);
+    writer->records = (uint8_t*)malloc(writer->records_capacity);
+    if (!writer->records || fopen_s(&writer->file, path, "wb") != 0 || !writer->file) {
+        writer->file = NULL;
+        free(writer->records);
+        free_tile_tracker(&writer->tiles);
+        return false;
+    }
+
+    uint8_t header[16];
+    memcpy(header, "DLT1", 4);
+    put_u32(put_u32(put_u32(header + 4, (uint32_t)width), (uint32_t)height), DELTA_TILE_SIZE);
+    writer->bytes_written = fwrite(header, 1, sizeof(header), writer->file);
+    return writer->bytes_written == sizeof(header);
+}
+
+bool write_delta_frame(delta_writer_t* writer, const uint32_t* pixels) {
+    tile_tracker_t* tiles = &writer->tiles;
+    track_frame_tiles(tiles, pixels);
+
+    //Count goes in front once the records are known
+    uint8_t* out = writer->records + sizeof(uint32_t);
+    uint32_t n_records = 0;
+    int n_tiles = tiles->tiles_x * tiles->tiles_y;
+
+    for (int tile = 0; tile < n_tiles; ) {
+        if (!tiles->changed[tile]) {
+            int run = 1;
+            while (tile + run < n_tiles && !tiles->changed[tile + run] && run < UINT16_MAX) {
+                run++;
+            }
+            uint16_t count = (uint16_t)run;
+            *out++ = DELTA_REPEAT;
+            memcpy(out, &count, sizeof(count));
+            out += sizeof(count);
+            n_records++;
+            tile += run;
+            continue;
+        }
+
+        int x = (tile % tiles->tiles_x) * DELTA_TILE_SIZE;
+        int y = (tile / tiles->tiles_x) * DELTA_TILE_SIZE;
+        int width = tiles->width - x < DELTA_TILE_SIZE ? tiles->width - x : DELTA_TILE_SIZE;
+        int height = tiles->height - y < DELTA_TILE_SIZE ? tiles->height - y : DELTA_TILE_SIZE;
+
+        *out++ = DELTA_TILE;
+        for (int row = 0; row < height; row++) {
+            memcpy(out, pixels + (size_t)(y + row) * tiles->width + x, width * sizeof(uint32_t));
+            out += width * sizeof(uint32_t);
+        }
+        n_records++;
+        tile++;
+    }
+
+    put_u32(writer->records, n_records);
+    size_t size = (size_t)(out - writer->records);
+    size_t written = fwrite(writer->records, 1, size, writer->file);
+    writer->bytes_written += written;
+    writer->n_frames++;
+    writer->failed |= written != size;
+    return written == size;
+}
+
+bool close_delta_writer(delta_writer_t* writer) {
+    bool ok = writer->file && !writer->failed && fflush(writer->file) == 0;
+    if (writer->file) {
+        ok = fclose(writer->file) == 0 && ok;
+    }
+    free(writer->records);
+    free_tile_tracker(&writer->tiles);
+    writer->file = NULL;
+    writer->records = NULL;
+    return ok;
+}
@@ -0,0 +1,62 @@
+#ifndef DELTA_H
+#define DELTA_H
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+//Side of the square tiles frames are compared in, edge tiles are clipped to the frame
+#define DELTA_TILE_SIZE 64
+
+typedef struct {
+    int width;
+    int height;
+    int tiles_x;
+    int tiles_y;
+    uint64_t* hashes; //of the last tracked frame, row-major
+    bool* changed; //per tile, set by the last track_frame_tiles
+    bool has_previous;
+    int n_changed; //in the last tracked frame
+    uint64_t tiles_tracked; //running totals
+    uint64_t tiles_skipped;
+} tile_tracker_t;
+
+bool init_tile_tracker(tile_tracker_t* tracker, int width, int height);
+void free_tile_tracker(tile_tracker_t* tracker);
+
+//Hashes every tile of an ARGB frame and marks the ones whose hash differs from the last tracked
+//frame, all of them on the first. Returns how many changed
+int track_frame_tiles(tile_tracker_t* tracker, const uint32_t* pixels);
+
+//Unchanged share of the last tracked frame, and of every frame so far
+double last_skipped_fraction(const tile_tracker_t* tracker);
+double total_skipped_fraction(const tile_tracker_t* tracker);
+
+//Delta stream, little endian
+//  header: "DLT1", then u32 width, height and tile size
+//  frame:  u32 record count, then records covering every tile in row-major order
+//  record: u8 DELTA_REPEAT, u16 n   the next n tiles are the same as in the last frame
+//          u8 DELTA_TILE, pixels    the next tile, its rows clipped to the frame, in ARGB
+typedef enum {
+    DELTA_REPEAT = 0,
+    DELTA_TILE = 1
+} delta_record_t;
+
+typedef struct {
+    FILE* file;
+    tile_tracker_t tiles;
+    uint8_t* records; //one frame, written with a single fwrite
+    size_t records_capacity;
+    int n_frames;
+    uint64_t bytes_written;
+    bool failed; //a write came up short
+} delta_writer_t;
+
+bool open_delta_writer(delta_writer_t* writer, const char* path, int width, int height);
+
+//Frames have to come in order, every one is encoded against the one before it
+bool write_delta_frame(delta_writer_t* writer, const uint32_t* pixels);
+
+//Returns false if anything failed to reach the file
+bool close_delta_writer(delta_writer_t* writer);
+
+#endif
@@ -0,0 +1,134 @@
+#include "depth.h"
+#include <stdlib.h>
+#include <string.h>
+
+static bool grow_depth_list(depth_list_t* list, int needed) {
+    if (needed <= list->capacity) {
+        return true;
+    }
+    int new_capacity = list->capacity > 0 ? list->capacity : 256;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+
+    //Scratch never holds anything between sorts, only the live arrays keep their contents
+    const triangle_t** faces = (const triangle_t**)realloc((void*)list->faces, new_capacity * sizeof(*faces));
+    if (faces) {
+        list->faces = faces;
+    }
+    uint32_t* keys = (uint32_t*)realloc(list->keys, new_capacity * sizeof(*keys));
+    if (keys) {
+        list->keys = keys;
+    }
+    free((void*)list->scratch_faces);
+    free(list->scratch_keys);
+    list->scratch_faces = (const triangle_t**)malloc(new_capacity * sizeof(*list->scratch_faces));
+    list->scratch_keys = (uint32_t*)malloc(new_capacity * sizeof(*list->scratch_keys));
+
+    if (!faces || !keys || !list->scratch_faces || !list->scratch_keys) {
+        return false;
+    }
+    list->capacity = new_capacity;
+    return true;
+}
+
+void reset_depth_list(depth_list_t* list) {
+    list->count = 0;
+}
+
+void free_depth_list(depth_list_t* list) {
+    free((void*)list->faces);
+    free(list->keys);
+    free((void*)list->scratch_faces);
+    free(list->scratch_keys);
+    depth_list_t empty = { 0 };
+    *list = empty;
+}
+
+uint32_t float_sort_key(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    //Negative floats order backwards, so all their bits flip. Positive ones only need the sign set
+    uint32_t mask = (uint32_t)(-(int32_t)(bits >> 31)) | 0x80000000u;
+    return bits ^ mask;
+}
+
+bool add_depth_faces(depth_list_t* list, const triangle_t* triangles, int n_triangles) {
+    if (n_triangles <= 0) {
+        return true;
+    }
+    if (!grow_depth_list(list, list->count + n_triangles)) {
+        return false;
+    }
+
+    //Inverted so that ascending order is farthest first
+    for (int i = 0; i < n_triangles; i++) {
+        list->faces[list->count] = &triangles[i];
+        list->keys[list->count] = ~float_sort_key(triangles[i].depth);
+        list->count++;
+    }
+    return true;
+}
+
+void radix_sort_keys(uint32_t* keys, const void** values, uint32_t* scratch_keys, const void** scratch_values, int count) {
+    //All four histograms in one read of the keys. On the stack, so workers can sort at the same time
+    uint32_t histograms[4][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (int i = 0; i < count; i++) {
+        uint32_t key = keys[i];
+        histograms[0][key & 0xFF]++;
+        histograms[1][(key >> 8) & 0xFF]++;
+        histograms[2][(key >> 16) & 0xFF]++;
+        histograms[3][key >> 24]++;
+    }
+
+    uint32_t* from_keys = keys;
+    const void** from_values = values;
+    uint32_t* to_keys = scratch_keys;
+    const void** to_values = scratch_values;
+
+    for (int pass = 0; pass < 4; pass++) {
+        uint32_t* histogram = histograms[pass];
+        int shift = pass * 8;
+
+        if (count == 0 || histogram[(from_keys[0] >> shift) & 0xFF] == (uint32_t)count) {
+            continue;
+        }
+
+        //Counts to starting offsets
+        uint32_t offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            uint32_t digit_count = histogram[digit];
+            histogram[digit] = offset;
+            offset += digit_count;
+        }
+
+        for (int i = 0; i < count; i++) {
+            uint32_t key = from_keys[i];
+            uint32_t destination = histogram[(key >> shift) & 0xFF]++;
+            to_keys[destination] = key;
+            to_values[destination] = from_values[i];
+        }
+
+        uint32_t* swap_keys = from_keys;
+        from_keys = to_keys;
+        to_keys = swap_keys;
+        const void** swap_values = from_values;
+        from_values = to_values;
+        to_values = swap_values;
+    }
+
+    //An odd number of passes left the result in scratch
+    if (from_keys != keys) {
+        memcpy(keys, from_keys, count * sizeof(uint32_t));
+        memcpy((void*)values, (const void*)from_values, count * sizeof(void*));
+    }
+}
+
+void sort_depth_list(depth_list_t* list) {
+    if (list->count < 2 || !list->scratch_keys || !list->scratch_faces) {
+        return;
+    }
+    radix_sort_keys(list->keys, (const void**)list->faces, list->scratch_keys, (const void**)list->scratch_faces, list->count);
+}
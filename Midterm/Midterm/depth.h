@@ -0,0 +1,33 @@
+#ifndef DEPTH_H
+#define DEPTH_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "vector.h"
+#include "triangle.h"
+
+//Faces of every mesh projected this frame, merged so they can be painted back to front.
+//Grows to the busiest frame and is then reused
+typedef struct {
+    const triangle_t** faces; //point into the frame arena lists, valid until the end of the frame
+    uint32_t* keys;
+    int count;
+    int capacity;
+    const triangle_t** scratch_faces;
+    uint32_t* scratch_keys;
+} depth_list_t;
+
+void reset_depth_list(depth_list_t* list);
+void free_depth_list(depth_list_t* list);
+bool add_depth_faces(depth_list_t* list, const triangle_t* triangles, int n_triangles);
+
+//Stable, farthest first
+void sort_depth_list(depth_list_t* list);
+
+//Unsigned key that orders like the float, negative values and -0 included
+uint32_t float_sort_key(float value);
+
+//LSD radix sort, 8 bits per pass, ascending and stable. Passes where every key shares the digit
+//are skipped. The result ends up in keys/values, scratch needs room for count of each. Reentrant
+void radix_sort_keys(uint32_t* keys, const void** values, uint32_t* scratch_keys, const void** scratch_values, int count);
+
+#endif
@@ -0,0 +1,216 @@
+#include "hud.h"
+#include "cull.h"
+#include "layer.h"
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//5x7 glyphs, one byte per row with the leftmost pixel in bit 4
+#define GLYPH_WIDTH 5
+#define GLYPH_HEIGHT 7
+
+static const char glyph_chars[] = " 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:-/%";
+
+static const uint8_t glyph_rows[][GLYPH_HEIGHT] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // space
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // 0
+    {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 1
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // 2
+    {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 3
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // 4
+    {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 5
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // 6
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // 8
+    {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 9
+    {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}, // A
+    {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // B
+    {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // C
+    {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // D
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // E
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // F
+    {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // G
+    {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // H
+    {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // I
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // J
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // L
+    {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // N
+    {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // O
+    {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // P
+    {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // Q
+    {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // R
+    {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // S
+    {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // U
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // V
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // W
+    {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // X
+    {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}, // Y
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // Z
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // .
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // :
+    {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // -
+    {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // /
+    {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}  // %
+};
+
+#define N_GLYPHS ((int)sizeof(glyph_rows) / GLYPH_HEIGHT)
+
+//Glyphs are scaled up and padded into cells, every cell row is one span copy
+#define GLYPH_SCALE 2
+#define CELL_WIDTH ((GLYPH_WIDTH + 1) * GLYPH_SCALE)
+#define CELL_HEIGHT ((GLYPH_HEIGHT + 2) * GLYPH_SCALE)
+
+#define HUD_MARGIN 8
+#define HUD_PANEL_WIDTH (30 * CELL_WIDTH)
+#define HUD_GRAPH_HEIGHT 60
+#define HUD_TEXT_COLOR 0xFFFFFFFF
+#define HUD_PANEL_COLOR 0xFF202020
+#define HUD_GRAPH_COLOR 0xFF40C040
+#define HUD_SLOW_COLOR 0xFFE04040
+
+//Frame time at the top of the graph, in budgets
+#define HUD_GRAPH_BUDGETS 1.5
+
+//Frames paced to the budget land a little over it, only this far over counts as slow
+#define HUD_BUDGET_TOLERANCE 1.1
+
+static const char* stage_names[N_HUD_STAGES] = { "CLEAR", "DRAW", "PROJECT", "UPLOAD", "PRESENT" };
+
+static uint32_t* atlas = NULL; //N_GLYPHS cells side by side, CELL_HEIGHT rows
+static int atlas_width = 0;
+static int8_t glyph_of_char[128];
+
+static double stage_ms[N_HUD_STAGES]; //being measured
+static double shown_stage_ms[N_HUD_STAGES]; //last closed frame
+static double frame_ms[HUD_GRAPH_FRAMES];
+static int newest_frame = 0;
+static uint64_t frame_start = 0;
+static double budget = 0;
+
+bool init_hud(double budget_ms) {
+    budget = budget_ms;
+    atlas_width = N_GLYPHS * CELL_WIDTH;
+    atlas = (uint32_t*)malloc((size_t)atlas_width * CELL_HEIGHT * sizeof(uint32_t));
+    if (!atlas) {
+        return false;
+    }
+
+    //Text over the panel color, so blits are plain copies
+    for (int i = 0; i < atlas_width * CELL_HEIGHT; i++) {
+        atlas[i] = HUD_PANEL_COLOR;
+    }
+    for (int g = 0; g < N_GLYPHS; g++) {
+        for (int row = 0; row < GLYPH_HEIGHT * GLYPH_SCALE; row++) {
+            uint8_t bits = glyph_rows[g][row / GLYPH_SCALE];
+            uint32_t* cell_row = atlas + (size_t)(row + GLYPH_SCALE) * atlas_width + g * CELL_WIDTH;
+            for (int column = 0; column < GLYPH_WIDTH * GLYPH_SCALE; column++) {
+                if (bits & (0x10 >> (column / GLYPH_SCALE))) {
+                    cell_row[column] = HUD_TEXT_COLOR;
+                }
+            }
+        }
+    }
+
+    //Lower case shares the upper case glyphs, anything else is a space
+    memset(glyph_of_char, 0, sizeof(glyph_of_char));
+    for (int g = 0; g < N_GLYPHS; g++) {
+        unsigned char c = (unsigned char)glyph_chars[g];
+        glyph_of_char[c] = (int8_t)g;
+        if (c >= 'A' && c <= 'Z') {
+            glyph_of_char[c - 'A' + 'a'] = (int8_t)g;
+        }
+    }
+
+    frame_start = SDL_GetPerformanceCounter();
+    return true;
+}
+
+void free_hud(void) {
+    free(atlas);
+    atlas = NULL;
+}
+
+uint64_t hud_time_stage(hud_stage_t stage, uint64_t since) {
+    uint64_t now = SDL_GetPerformanceCounter();
+    hud_add_stage_ticks(stage, now - since);
+    return now;
+}
+
+void hud_add_stage_ticks(hud_stage_t stage, uint64_t ticks) {
+    stage_ms[stage] += (double)ticks * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+void hud_next_frame(void) {
+    uint64_t now = SDL_GetPerformanceCounter();
+    newest_frame = (newest_frame + 1) % HUD_GRAPH_FRAMES;
+    frame_ms[newest_frame] = (double)(now - frame_start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    frame_start = now;
+
+    memcpy(shown_stage_ms, stage_ms, sizeof(stage_ms));
+    memset(stage_ms, 0, sizeof(stage_ms));
+}
+
+//One memcpy per cell row, glyphs that would cross the framebuffer edge are skipped
+static void draw_text(framebuffer_t* framebuffer, int x, int y, const char* text) {
+    uint32_t* pixels = (uint32_t*)framebuffer->pixels;
+    if (y < 0 || y + CELL_HEIGHT > framebuffer->height) {
+        return;
+    }
+
+    for (; *text && x + CELL_WIDTH <= framebuffer->width; text++, x += CELL_WIDTH) {
+        unsigned char c = (unsigned char)*text;
+        int glyph = c < 128 ? glyph_of_char[c] : 0;
+        const uint32_t* source = atlas + glyph * CELL_WIDTH;
+        uint32_t* target = pixels + (size_t)y * framebuffer->width + x;
+        for (int row = 0; row < CELL_HEIGHT; row++) {
+            memcpy(target, source, CELL_WIDTH * sizeof(uint32_t));
+            source += atlas_width;
+            target += framebuffer->width;
+        }
+    }
+}
+
+void draw_hud(framebuffer_t* framebuffer, uint64_t pixels_written, double tiles_skipped) {
+    if (!atlas || framebuffer->format != PIXEL_ARGB8888) {
+        return;
+    }
+
+    char lines[N_HUD_STAGES + 5][48];
+    int n_lines = 0;
+
+    double last_ms = frame_ms[newest_frame];
+    snprintf(lines[n_lines++], sizeof(lines[0]), "FPS %5.1f  FRAME %6.2f MS", last_ms > 0 ? 1000.0 / last_ms : 0.0, last_ms);
+    for (int s = 0; s < N_HUD_STAGES; s++) {
+        snprintf(lines[n_lines++], sizeof(lines[0]), "%-8s %6.2f MS", stage_names[s], shown_stage_ms[s]);
+    }
+    snprintf(lines[n_lines++], sizeof(lines[0]), "PIXELS %llu", (unsigned long long)pixels_written);
+    snprintf(lines[n_lines++], sizeof(lines[0]), "CULLED %d OBJ %d PRIM", cull_stats.objects_culled, cull_stats.primitives_culled);
+    snprintf(lines[n_lines++], sizeof(lines[0]), "LAYERS %d REDRAWN %d REUSED", layer_stats.redrawn, layer_stats.reused);
+    snprintf(lines[n_lines++], sizeof(lines[0]), "TILES SKIPPED %3.0f%%", tiles_skipped * 100.0);
+
+    int x = HUD_MARGIN;
+    int y = HUD_MARGIN;
+    int graph_y = y + n_lines * CELL_HEIGHT + HUD_MARGIN;
+    raster_fill_rect(framebuffer, x - HUD_MARGIN / 2, y - HUD_MARGIN / 2, HUD_PANEL_WIDTH + HUD_MARGIN, graph_y - y + HUD_GRAPH_HEIGHT + HUD_MARGIN, HUD_PANEL_COLOR);
+
+    for (int i = 0; i < n_lines; i++) {
+        draw_text(framebuffer, x, y + i * CELL_HEIGHT, lines[i]);
+    }
+
+    //Oldest frame on the left, bars beyond the tolerance over budget in red
+    int bar_width = HUD_PANEL_WIDTH / HUD_GRAPH_FRAMES;
+    bar_width = bar_width > 0 ? bar_width : 1;
+    for (int i = 0; i < HUD_GRAPH_FRAMES; i++) {
+        double ms = frame_ms[(newest_frame + 1 + i) % HUD_GRAPH_FRAMES];
+        int height = (int)(ms / (budget * HUD_GRAPH_BUDGETS) * HUD_GRAPH_HEIGHT);
+        height = height < HUD_GRAPH_HEIGHT ? height : HUD_GRAPH_HEIGHT;
+        raster_fill_rect(framebuffer, x + i * bar_width, graph_y + HUD_GRAPH_HEIGHT - height, bar_width, height,
+            ms > budget * HUD_BUDGET_TOLERANCE ? HUD_SLOW_COLOR : HUD_GRAPH_COLOR);
+    }
+    int budget_y = graph_y + HUD_GRAPH_HEIGHT - (int)(HUD_GRAPH_HEIGHT / HUD_GRAPH_BUDGETS);
+    raster_fill_rect(framebuffer, x, budget_y, bar_width * HUD_GRAPH_FRAMES, 1, HUD_TEXT_COLOR);
+}
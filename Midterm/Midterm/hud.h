@@ -0,0 +1,36 @@
+#ifndef HUD_H
+#define HUD_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "raster.h"
+
+//Frames kept for the frame-time graph
+#define HUD_GRAPH_FRAMES 120
+
+typedef enum {
+    HUD_STAGE_CLEAR,
+    HUD_STAGE_DRAW,
+    HUD_STAGE_PROJECT,
+    HUD_STAGE_UPLOAD,
+    HUD_STAGE_PRESENT,
+    N_HUD_STAGES
+} hud_stage_t;
+
+//Builds the font atlas. Graph bars clearly above the frame budget are drawn in red
+bool init_hud(double budget_ms);
+void free_hud(void);
+
+//Adds the time since since to the stage and returns now, so stages can be chained
+uint64_t hud_time_stage(hud_stage_t stage, uint64_t since);
+
+//Adds performance counter ticks measured elsewhere, such as a recorder's projection time
+void hud_add_stage_ticks(hud_stage_t stage, uint64_t ticks);
+
+//Closes the frame, the overlay shows the last closed one
+void hud_next_frame(void);
+
+//Top left, over whatever is in the ARGB framebuffer. Counters are read from cull_stats,
+//tiles_skipped is the share of the last upload that was unchanged
+void draw_hud(framebuffer_t* framebuffer, uint64_t pixels_written, double tiles_skipped);
+
+#endif
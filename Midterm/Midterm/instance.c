@@ -0,0 +1,642 @@
+#include "instance.h"
+#include "cull.h"
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
+#include <windows.h>
+
+//Near plane plus the 4 guard-band planes
+#define N_CLIP_PLANES 5
+#define MAX_CLIP_VERTICES (3 + N_CLIP_PLANES)
+
+//Twice the screen area below which a triangle is dropped as degenerate
+#define MIN_TRIANGLE_AREA 1e-3f
+
+typedef struct {
+    const mesh_t* mesh;
+    const float* soa; //x, y and z blocks of padded_vertices floats each
+    int padded_vertices;
+    const int* indices; //3 per face, already rebased onto the vertex array
+    const float* normals; //x, y and z blocks of padded_faces floats each
+    int padded_faces;
+    const light_t* light;
+    float* scratch; //view xyz, projected xy and outcodes, padded_vertices each, then intensity and facing, padded_faces each
+    const instance_t* instances;
+    int first;
+    int count;
+    projection_t projection;
+    triangle_t* triangles_out;
+    int capacity;
+    int written;
+    int culled;
+    int rejected;
+    int clipped;
+    int backfaced;
+    int dropped;
+} instance_job_t;
+
+typedef struct {
+    vec3_t position;
+    bool edge; //the edge to the next vertex lies on the original face
+} clip_vertex_t;
+
+void instance_matrix(const instance_t* instance, float camera_z, float m[12]) {
+    vec3_t axes[3] = {
+        {.x = 1, .y = 0, .z = 0},
+        {.x = 0, .y = 1, .z = 0},
+        {.x = 0, .y = 0, .z = 1}
+    };
+
+    //Rotated basis vectors are the columns, so the order matches the per-vertex path
+    for (int i = 0; i < 3; i++) {
+        vec3_t axis = vec3_rotate_x(axes[i], instance->rotation.x);
+        axis = vec3_rotate_y(axis, instance->rotation.y);
+        axis = vec3_rotate_z(axis, instance->rotation.z);
+
+        m[0 + i] = axis.x * instance->scaling.x;
+        m[4 + i] = axis.y * instance->scaling.y;
+        m[8 + i] = axis.z * instance->scaling.z;
+    }
+
+    //Translation happens before scaling
+    m[3] = instance->translation.x * instance->scaling.x;
+    m[7] = instance->translation.y * instance->scaling.y;
+    m[11] = instance->translation.z * instance->scaling.z - camera_z;
+}
+
+uint32_t shade_color(uint32_t color, float intensity) {
+    uint32_t r = (uint32_t)(((color >> 16) & 0xFF) * intensity);
+    uint32_t g = (uint32_t)(((color >> 8) & 0xFF) * intensity);
+    uint32_t b = (uint32_t)((color & 0xFF) * intensity);
+    return (color & 0xFF000000) | (r << 16) | (g << 8) | b;
+}
+
+//Cofactor matrix of the linear part, transforms normals correctly under non-uniform scaling.
+//It equals det * inverse transpose, so the sign of det is divided back out
+static void normal_matrix(const float m[12], float n[9]) {
+    float r0[3] = { m[0], m[1], m[2] };
+    float r1[3] = { m[4], m[5], m[6] };
+    float r2[3] = { m[8], m[9], m[10] };
+
+    n[0] = r1[1] * r2[2] - r1[2] * r2[1];
+    n[1] = r1[2] * r2[0] - r1[0] * r2[2];
+    n[2] = r1[0] * r2[1] - r1[1] * r2[0];
+    n[3] = r2[1] * r0[2] - r2[2] * r0[1];
+    n[4] = r2[2] * r0[0] - r2[0] * r0[2];
+    n[5] = r2[0] * r0[1] - r2[1] * r0[0];
+    n[6] = r0[1] * r1[2] - r0[2] * r1[1];
+    n[7] = r0[2] * r1[0] - r0[0] * r1[2];
+    n[8] = r0[0] * r1[1] - r0[1] * r1[0];
+
+    float det = r0[0] * n[0] + r0[1] * n[1] + r0[2] * n[2];
+    if (det < 0) {
+        for (int i = 0; i < 9; i++) {
+            n[i] = -n[i];
+        }
+    }
+}
+
+//Rotates every face normal, tests it against the view ray to its first corner and lights it, 4 faces per step
+static void shade_faces(instance_job_t* job, const float m[12], const float* view_x, const float* view_y, const float* view_z, float* intensity, int* facing) {
+    int padded = job->padded_faces;
+    const float* nx = job->normals;
+    const float* ny = nx + padded;
+    const float* nz = ny + padded;
+    const light_t* light = job->light;
+
+    float n[9];
+    normal_matrix(m, n);
+    __m128 n0 = _mm_set1_ps(n[0]), n1 = _mm_set1_ps(n[1]), n2 = _mm_set1_ps(n[2]);
+    __m128 n3 = _mm_set1_ps(n[3]), n4 = _mm_set1_ps(n[4]), n5 = _mm_set1_ps(n[5]);
+    __m128 n6 = _mm_set1_ps(n[6]), n7 = _mm_set1_ps(n[7]), n8 = _mm_set1_ps(n[8]);
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 light_x = _mm_set1_ps(-light->direction.x);
+    __m128 light_y = _mm_set1_ps(-light->direction.y);
+    __m128 light_z = _mm_set1_ps(-light->direction.z);
+    __m128 ambient = _mm_set1_ps(light->ambient);
+    __m128 diffuse = _mm_set1_ps(1 - light->ambient);
+
+    for (int f = 0; f < padded; f += 4) {
+        __m128 x = _mm_loadu_ps(nx + f);
+        __m128 y = _mm_loadu_ps(ny + f);
+        __m128 z = _mm_loadu_ps(nz + f);
+
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n0, x), _mm_mul_ps(n1, y)), _mm_mul_ps(n2, z));
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n3, x), _mm_mul_ps(n4, y)), _mm_mul_ps(n5, z));
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n6, x), _mm_mul_ps(n7, y)), _mm_mul_ps(n8, z));
+
+        //Padding faces point at vertex 0 and have zero normals, so they never face the camera
+        int a[4];
+        for (int k = 0; k < 4; k++) {
+            a[k] = f + k < job->mesh->n_faces ? job->indices[3 * (f + k)] : 0;
+        }
+        __m128 px = _mm_setr_ps(view_x[a[0]], view_x[a[1]], view_x[a[2]], view_x[a[3]]);
+        __m128 py = _mm_setr_ps(view_y[a[0]], view_y[a[1]], view_y[a[2]], view_y[a[3]]);
+        __m128 pz = _mm_setr_ps(view_z[a[0]], view_z[a[1]], view_z[a[2]], view_z[a[3]]);
+
+        //The camera sits at the origin
+        __m128 toward = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, px), _mm_mul_ps(ry, py)), _mm_mul_ps(rz, pz));
+        _mm_storeu_si128((__m128i*)(facing + f), _mm_castps_si128(_mm_cmplt_ps(toward, zero)));
+
+        __m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_mul_ps(rz, rz));
+        __m128 lambert = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, light_x), _mm_mul_ps(ry, light_y)), _mm_mul_ps(rz, light_z));
+        lambert = _mm_max_ps(_mm_mul_ps(lambert, _mm_rsqrt_ps(length_squared)), zero);
+        _mm_storeu_ps(intensity + f, _mm_min_ps(_mm_add_ps(ambient, _mm_mul_ps(diffuse, lambert)), _mm_set1_ps(1)));
+    }
+}
+
+vec2_t perspective_project_point(vec3_t point_3d, projection_t projection) {
+    vec2_t projected_point = {
+        .x = (projection.scaling_factor * point_3d.x) / point_3d.z + projection.center_x,
+        .y = (projection.scaling_factor * point_3d.y) / point_3d.z + projection.center_y
+    };
+    return projected_point;
+}
+
+//Homogeneous planes (w = z), a point is inside when dot(plane, (x, y, z, 1)) >= 0
+static void build_clip_planes(projection_t projection, float planes[N_CLIP_PLANES][4]) {
+    float f = projection.scaling_factor;
+    float reach_x = projection.center_x + CLIP_GUARD_BAND;
+    float reach_y = projection.center_y + CLIP_GUARD_BAND;
+
+    float near_plane[4] = { 0, 0, 1, -NEAR_PLANE_Z };
+    float left_plane[4] = { f, 0, reach_x, 0 };
+    float right_plane[4] = { -f, 0, reach_x, 0 };
+    float top_plane[4] = { 0, f, reach_y, 0 };
+    float bottom_plane[4] = { 0, -f, reach_y, 0 };
+
+    memcpy(planes[0], near_plane, sizeof(near_plane));
+    memcpy(planes[1], left_plane, sizeof(left_plane));
+    memcpy(planes[2], right_plane, sizeof(right_plane));
+    memcpy(planes[3], top_plane, sizeof(top_plane));
+    memcpy(planes[4], bottom_plane, sizeof(bottom_plane));
+}
+
+static float plane_distance(const float plane[4], vec3_t v) {
+    return plane[0] * v.x + plane[1] * v.y + plane[2] * v.z + plane[3];
+}
+
+//One Sutherland-Hodgman pass, keeping track of which output edges are real face edges
+static int clip_polygon_against_plane(const clip_vertex_t* in, int count, const float plane[4], clip_vertex_t* out) {
+    int out_count = 0;
+    for (int i = 0; i < count; i++) {
+        clip_vertex_t p = in[i];
+        clip_vertex_t q = in[(i + 1) % count];
+        float dp = plane_distance(plane, p.position);
+        float dq = plane_distance(plane, q.position);
+
+        if (dp >= 0) {
+            out[out_count++] = p;
+        }
+        if ((dp >= 0) != (dq >= 0)) {
+            float t = dp / (dp - dq);
+            clip_vertex_t intersection = {
+                .position = {
+                    .x = p.position.x + (q.position.x - p.position.x) * t,
+                    .y = p.position.y + (q.position.y - p.position.y) * t,
+                    .z = p.position.z + (q.position.z - p.position.z) * t
+                },
+                //Leaving: the next edge runs along the plane. Entering: it is the rest of p -> q
+                .edge = dp >= 0 ? false : p.edge
+            };
+            out[out_count++] = intersection;
+        }
+    }
+    return out_count;
+}
+
+static void emit_triangle(instance_job_t* job, vec2_t p0, vec2_t p1, vec2_t p2, uint32_t color, int edge_mask, float depth) {
+    float area = (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x);
+
+    //Also catches NaN
+    if (!(fabsf(area) >= MIN_TRIANGLE_AREA)) {
+        job->rejected++;
+        return;
+    }
+    if (job->written == job->capacity) {
+        job->dropped++;
+        return;
+    }
+
+    triangle_t* triangle = &job->triangles_out[job->written++];
+    triangle->points[0] = p0;
+    triangle->points[1] = p1;
+    triangle->points[2] = p2;
+    triangle->color = color;
+    triangle->edge_mask = edge_mask;
+    triangle->depth = depth;
+    triangle->outlined = false;
+}
+
+static void clip_and_emit_face(instance_job_t* job, const float planes[N_CLIP_PLANES][4], int outside, vec3_t a, vec3_t b, vec3_t c, uint32_t color) {
+    clip_vertex_t polygon[2][MAX_CLIP_VERTICES] = {
+        {
+            {.position = a, .edge = true },
+            {.position = b, .edge = true },
+            {.position = c, .edge = true }
+        }
+    };
+    int current = 0;
+    int count = 3;
+
+    //Every piece keeps the depth of the whole face
+    float depth = (a.z + b.z + c.z) / 3;
+
+    //Only the planes some corner is outside of
+    for (int k = 0; k < N_CLIP_PLANES && count >= 3; k++) {
+        if (outside & (1 << k)) {
+            count = clip_polygon_against_plane(polygon[current], count, planes[k], polygon[1 - current]);
+            current = 1 - current;
+        }
+    }
+    if (count < 3) {
+        job->rejected++;
+        return;
+    }
+
+    vec2_t projected[MAX_CLIP_VERTICES];
+    for (int i = 0; i < count; i++) {
+        projected[i] = perspective_project_point(polygon[current][i].position, job->projection);
+    }
+
+    //Fan from the first vertex, the diagonals are seams
+    const clip_vertex_t* v = polygon[current];
+    for (int i = 1; i < count - 1; i++) {
+        int edge_mask = 0;
+        edge_mask |= (i == 1 && v[0].edge) ? 1 : 0;
+        edge_mask |= v[i].edge ? 2 : 0;
+        edge_mask |= (i == count - 2 && v[count - 1].edge) ? 4 : 0;
+        emit_triangle(job, projected[0], projected[i], projected[i + 1], color, edge_mask, depth);
+    }
+}
+
+static void project_instance_range(instance_job_t* job) {
+    const mesh_t* mesh = job->mesh;
+    int padded = job->padded_vertices;
+    const float* vx = job->soa;
+    const float* vy = vx + padded;
+    const float* vz = vy + padded;
+
+    float* view_x = job->scratch;
+    float* view_y = view_x + padded;
+    float* view_z = view_y + padded;
+    float* projected_x = view_z + padded;
+    float* projected_y = projected_x + padded;
+    int* outcodes = (int*)(projected_y + padded);
+    float* intensity = (float*)(outcodes + padded);
+    int* facing = (int*)(intensity + job->padded_faces);
+
+    float planes[N_CLIP_PLANES][4];
+    build_clip_planes(job->projection, planes);
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 scaling_factor = _mm_set1_ps(job->projection.scaling_factor);
+    __m128 center_x = _mm_set1_ps(job->projection.center_x);
+    __m128 center_y = _mm_set1_ps(job->projection.center_y);
+
+    for (int n = job->first; n < job->first + job->count; n++) {
+        float m[12];
+        instance_matrix(&job->instances[n], job->projection.camera_z, m);
+
+        //Bounding sphere before any vertex work
+        if (mesh->bound_radius > 0) {
+            vec3_t c = mesh->bound_center;
+            vec3_t center = {
+                .x = m[0] * c.x + m[1] * c.y + m[2] * c.z + m[3],
+                .y = m[4] * c.x + m[5] * c.y + m[6] * c.z + m[7],
+                .z = m[8] * c.x + m[9] * c.y + m[10] * c.z + m[11]
+            };
+            vec3_t scaling = job->instances[n].scaling;
+            float max_scale = fmaxf(fabsf(scaling.x), fmaxf(fabsf(scaling.y), fabsf(scaling.z)));
+
+            if (sphere_outside_frustum(center, mesh->bound_radius * max_scale, job->projection)) {
+                job->culled++;
+                continue;
+            }
+        }
+
+        __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]), m3 = _mm_set1_ps(m[3]);
+        __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]);
+        __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]), m11 = _mm_set1_ps(m[11]);
+
+        //4 vertices per step: view space, outcodes, then the divide (only used when no plane is crossed)
+        for (int i = 0; i < padded; i += 4) {
+            __m128 x = _mm_loadu_ps(vx + i);
+            __m128 y = _mm_loadu_ps(vy + i);
+            __m128 z = _mm_loadu_ps(vz + i);
+
+            __m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m1, y)), _mm_add_ps(_mm_mul_ps(m2, z), m3));
+            __m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m4, x), _mm_mul_ps(m5, y)), _mm_add_ps(_mm_mul_ps(m6, z), m7));
+            __m128 tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m8, x), _mm_mul_ps(m9, y)), _mm_add_ps(_mm_mul_ps(m10, z), m11));
+
+            __m128i outcode = _mm_setzero_si128();
+            for (int k = 0; k < N_CLIP_PLANES; k++) {
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[k][0]), tx), _mm_mul_ps(_mm_set1_ps(planes[k][1]), ty)),
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[k][2]), tz), _mm_set1_ps(planes[k][3])));
+                __m128i outside = _mm_castps_si128(_mm_cmplt_ps(distance, zero));
+                outcode = _mm_or_si128(outcode, _mm_and_si128(outside, _mm_set1_epi32(1 << k)));
+            }
+
+            _mm_storeu_ps(view_x + i, tx);
+            _mm_storeu_ps(view_y + i, ty);
+            _mm_storeu_ps(view_z + i, tz);
+            _mm_storeu_si128((__m128i*)(outcodes + i), outcode);
+            _mm_storeu_ps(projected_x + i, _mm_add_ps(_mm_div_ps(_mm_mul_ps(scaling_factor, tx), tz), center_x));
+            _mm_storeu_ps(projected_y + i, _mm_add_ps(_mm_div_ps(_mm_mul_ps(scaling_factor, ty), tz), center_y));
+        }
+
+        if (job->light) {
+            shade_faces(job, m, view_x, view_y, view_z, intensity, facing);
+        }
+
+        //Faces share vertices, so they are only gathered here
+        for (int f = 0; f < mesh->n_faces; f++) {
+            int a = job->indices[3 * f + 0];
+            int b = job->indices[3 * f + 1];
+            int c = job->indices[3 * f + 2];
+
+            //Hidden faces are never shaded or clipped
+            uint32_t color = job->instances[n].color;
+            if (job->light) {
+                if (!facing[f]) {
+                    job->backfaced++;
+                    continue;
+                }
+                color = shade_color(color, intensity[f]);
+            }
+
+            //All corners behind the same plane
+            if (outcodes[a] & outcodes[b] & outcodes[c]) {
+                job->rejected++;
+                continue;
+            }
+
+            int outside = outcodes[a] | outcodes[b] | outcodes[c];
+            if (outside == 0) {
+                emit_triangle(job,
+                    (vec2_t){ .x = projected_x[a], .y = projected_y[a] },
+                    (vec2_t){ .x = projected_x[b], .y = projected_y[b] },
+                    (vec2_t){ .x = projected_x[c], .y = projected_y[c] },
+                    color, TRIANGLE_ALL_EDGES, (view_z[a] + view_z[b] + view_z[c]) / 3);
+                continue;
+            }
+
+            job->clipped++;
+            clip_and_emit_face(job, planes, outside,
+                (vec3_t){ .x = view_x[a], .y = view_y[a], .z = view_z[a] },
+                (vec3_t){ .x = view_x[b], .y = view_y[b], .z = view_z[b] },
+                (vec3_t){ .x = view_x[c], .y = view_y[c], .z = view_z[c] },
+                color);
+        }
+    }
+}
+
+static DWORD WINAPI project_instance_worker(LPVOID data) {
+    instance_job_t* job = (instance_job_t*)data;
+    if (!job->scratch) {
+        job->dropped += job->count * job->mesh->n_faces;
+        return 1;
+    }
+
+    project_instance_range(job);
+    return 0;
+}
+
+//Threads started once by init_instance_workers() and handed a range per batch
+typedef struct {
+    CRITICAL_SECTION submit_lock; //held by the one caller whose batch the pool is running
+    CRITICAL_SECTION lock; //guards everything below
+    CONDITION_VARIABLE work_ready;
+    CONDITION_VARIABLE work_done;
+    HANDLE threads[MAX_INSTANCE_THREADS];
+    int n_threads;
+    instance_job_t* jobs; //jobs[t] belongs to pool thread t
+    int n_jobs;
+    int pending;
+    unsigned batch; //bumped each time a batch is handed out
+    bool stopping;
+    bool running;
+} instance_pool_t;
+
+static instance_pool_t pool;
+
+static DWORD WINAPI instance_pool_thread(LPVOID data) {
+    int index = (int)(intptr_t)data;
+    unsigned seen = 0;
+
+    EnterCriticalSection(&pool.lock);
+    for (;;) {
+        while (!pool.stopping && pool.batch == seen) {
+            SleepConditionVariableCS(&pool.work_ready, &pool.lock, INFINITE);
+        }
+        if (pool.stopping) {
+            break;
+        }
+        seen = pool.batch;
+        if (index >= pool.n_jobs) {
+            continue;
+        }
+
+        instance_job_t* job = &pool.jobs[index];
+        LeaveCriticalSection(&pool.lock);
+        project_instance_worker(job);
+        EnterCriticalSection(&pool.lock);
+        if (--pool.pending == 0) {
+            WakeAllConditionVariable(&pool.work_done);
+        }
+    }
+    LeaveCriticalSection(&pool.lock);
+    return 0;
+}
+
+bool init_instance_workers(void) {
+    if (pool.running) {
+        return true;
+    }
+
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    int worker_count = (int)system_info.dwNumberOfProcessors;
+    if (worker_count > MAX_INSTANCE_THREADS) {
+        worker_count = MAX_INSTANCE_THREADS;
+    }
+
+    InitializeCriticalSection(&pool.submit_lock);
+    InitializeCriticalSection(&pool.lock);
+    InitializeConditionVariable(&pool.work_ready);
+    InitializeConditionVariable(&pool.work_done);
+    pool.n_threads = 0;
+    pool.batch = 0;
+    pool.stopping = false;
+    pool.running = true;
+
+    //The calling thread takes the last range, so one core needs no pool thread
+    for (int t = 0; t < worker_count - 1; t++) {
+        pool.threads[t] = CreateThread(NULL, 0, instance_pool_thread, (LPVOID)(intptr_t)t, 0, NULL);
+        if (!pool.threads[t]) {
+            break;
+        }
+        pool.n_threads++;
+    }
+    return pool.n_threads > 0 || worker_count <= 1;
+}
+
+void free_instance_workers(void) {
+    if (!pool.running) {
+        return;
+    }
+
+    EnterCriticalSection(&pool.lock);
+    pool.stopping = true;
+    WakeAllConditionVariable(&pool.work_ready);
+    LeaveCriticalSection(&pool.lock);
+
+    if (pool.n_threads > 0) {
+        WaitForMultipleObjects(pool.n_threads, pool.threads, TRUE, INFINITE);
+        for (int t = 0; t < pool.n_threads; t++) {
+            CloseHandle(pool.threads[t]);
+        }
+    }
+    DeleteCriticalSection(&pool.lock);
+    DeleteCriticalSection(&pool.submit_lock);
+    pool.n_threads = 0;
+    pool.running = false;
+}
+
+//Pool threads run jobs[0..n_jobs-1] while the caller runs jobs[n_jobs]
+static void run_on_pool(instance_job_t* jobs, int n_jobs) {
+    EnterCriticalSection(&pool.lock);
+    pool.jobs = jobs;
+    pool.n_jobs = n_jobs;
+    pool.pending = n_jobs;
+    pool.batch++;
+    WakeAllConditionVariable(&pool.work_ready);
+    LeaveCriticalSection(&pool.lock);
+
+    project_instance_worker(&jobs[n_jobs]);
+
+    EnterCriticalSection(&pool.lock);
+    while (pool.pending > 0) {
+        SleepConditionVariableCS(&pool.work_done, &pool.lock, INFINITE);
+    }
+    LeaveCriticalSection(&pool.lock);
+}
+
+static void count_instance_culling(cull_stats_t* stats, const mesh_t* mesh, int n_instances, const instance_job_t* jobs, int n_jobs) {
+    stats->objects_tested += n_instances;
+    stats->primitives_tested += n_instances * mesh->n_faces;
+    for (int w = 0; w < n_jobs; w++) {
+        stats->objects_culled += jobs[w].culled;
+        stats->primitives_culled += jobs[w].culled * mesh->n_faces + jobs[w].rejected + jobs[w].backfaced + jobs[w].dropped;
+        stats->primitives_clipped += jobs[w].clipped;
+        stats->primitives_backfaced += jobs[w].backfaced;
+    }
+}
+
+int project_mesh_instances(const mesh_t* mesh, const instance_t* instances, int n_instances, projection_t projection, const light_t* light, triangle_t* triangles_out, int capacity, arena_t* arena, cull_stats_t* stats) {
+    if (n_instances <= 0) {
+        return 0;
+    }
+
+    //Mesh vertices as padded SoA, zero filled past the last vertex
+    int padded = (mesh->n_vertices + 3) & ~3;
+    float* soa = ARENA_ALLOC_ARRAY(arena, float, 3 * padded);
+    int* indices = ARENA_ALLOC_ARRAY(arena, int, 3 * mesh->n_faces);
+    if (!soa || !indices) {
+        return 0;
+    }
+    memset(soa, 0, 3 * padded * sizeof(float));
+    for (int i = 0; i < mesh->n_vertices; i++) {
+        soa[i] = mesh->vertices[i].x;
+        soa[padded + i] = mesh->vertices[i].y;
+        soa[2 * padded + i] = mesh->vertices[i].z;
+    }
+
+    for (int f = 0; f < mesh->n_faces; f++) {
+        indices[3 * f + 0] = mesh_vertex_index(mesh, mesh->faces[f].a);
+        indices[3 * f + 1] = mesh_vertex_index(mesh, mesh->faces[f].b);
+        indices[3 * f + 2] = mesh_vertex_index(mesh, mesh->faces[f].c);
+    }
+
+    //Face normals as padded SoA, only needed when lighting
+    int padded_faces = (mesh->n_faces + 3) & ~3;
+    float* normals = NULL;
+    if (light) {
+        normals = ARENA_ALLOC_ARRAY(arena, float, 3 * padded_faces);
+        if (!normals) {
+            return 0;
+        }
+        memset(normals, 0, 3 * padded_faces * sizeof(float));
+        for (int f = 0; f < mesh->n_faces; f++) {
+            normals[f] = mesh->normals[f].x;
+            normals[padded_faces + f] = mesh->normals[f].y;
+            normals[2 * padded_faces + f] = mesh->normals[f].z;
+        }
+    }
+    int scratch_floats = 6 * padded + 2 * padded_faces;
+
+    instance_job_t job = {
+        .mesh = mesh,
+        .soa = soa,
+        .padded_vertices = padded,
+        .indices = indices,
+        .normals = normals,
+        .padded_faces = padded_faces,
+        .light = light,
+        .scratch = NULL,
+        .instances = instances,
+        .first = 0,
+        .count = n_instances,
+        .projection = projection,
+        .triangles_out = triangles_out,
+        .capacity = capacity
+    };
+
+    //A batch arriving while the pool runs another caller's batch stays on its own thread
+    bool pooled = pool.n_threads > 0 && n_instances * padded >= INSTANCE_THREAD_THRESHOLD && n_instances >= (pool.n_threads + 1) * 2 && TryEnterCriticalSection(&pool.submit_lock);
+    if (!pooled) {
+        job.scratch = ARENA_ALLOC_ARRAY(arena, float, scratch_floats);
+        project_instance_worker(&job);
+        count_instance_culling(stats, mesh, n_instances, &job, 1);
+        return job.written;
+    }
+
+    //Contiguous instance ranges, each writing into its share of the output
+    instance_job_t jobs[MAX_INSTANCE_THREADS];
+    int worker_count = pool.n_threads + 1;
+    int used = 0;
+    int per_worker = (n_instances + worker_count - 1) / worker_count;
+
+    for (int w = 0; w < worker_count; w++) {
+        jobs[w] = job;
+        jobs[w].first = w * per_worker;
+        jobs[w].count = n_instances - jobs[w].first < per_worker ? n_instances - jobs[w].first : per_worker;
+        if (jobs[w].count <= 0) {
+            break;
+        }
+
+        int region_begin = (int)((long long)capacity * jobs[w].first / n_instances);
+        int region_end = (int)((long long)capacity * (jobs[w].first + jobs[w].count) / n_instances);
+        jobs[w].triangles_out = triangles_out + region_begin;
+        jobs[w].capacity = region_end - region_begin;
+        jobs[w].scratch = ARENA_ALLOC_ARRAY(arena, float, scratch_floats);
+        used++;
+    }
+
+    run_on_pool(jobs, used - 1);
+    LeaveCriticalSection(&pool.submit_lock);
+
+    //Close the gaps between regions, they are in instance order already
+    int written = 0;
+    for (int w = 0; w < used; w++) {
+        if (jobs[w].triangles_out != triangles_out + written) {
+            memmove(triangles_out + written, jobs[w].triangles_out, jobs[w].written * sizeof(triangle_t));
+        }
+        written += jobs[w].written;
+    }
+
+    count_instance_culling(stats, mesh, n_instances, jobs, used);
+    return written;
+}
@@ -0,0 +1,65 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "vector.h"
+#include "triangle.h"
+#include "mesh.h"
+#include "arena.h"
+
+//cull.h includes this header for projection_t
+struct cull_stats;
+
+//Per-copy transform of a mesh, applied as rotate x/y/z, translate, scale
+typedef struct {
+    vec3_t scaling;
+    vec3_t rotation;
+    vec3_t translation;
+    uint32_t color;
+} instance_t;
+
+//Screen projection shared by every instance of a batch
+typedef struct {
+    float scaling_factor;
+    float camera_z;
+    float center_x;
+    float center_y;
+} projection_t;
+
+//Directional light in view space. Lit batches are flat shaded and drop back faces
+typedef struct {
+    vec3_t direction; //the way the light travels, unit length
+    float ambient; //intensity of faces turned away from the light
+} light_t;
+
+//Instances * vertices above which the batch is spread over worker threads
+#define INSTANCE_THREAD_THRESHOLD 4096
+#define MAX_INSTANCE_THREADS 16
+
+//Pixels past each screen edge that projected geometry may reach before it is clipped
+#define CLIP_GUARD_BAND 2048.0f
+
+//A face clipped by the near plane and 4 guard planes is at most an 8-gon, fanned into 6 triangles
+#define MAX_CLIPPED_TRIANGLES 6
+
+void instance_matrix(const instance_t* instance, float camera_z, float m[12]);
+
+//Divides a view-space point already clipped to z >= NEAR_PLANE_Z
+vec2_t perspective_project_point(vec3_t point_3d, projection_t projection);
+
+//Starts one worker thread per extra core, kept until free_instance_workers().
+//Without them every batch is projected on the calling thread
+bool init_instance_workers(void);
+void free_instance_workers(void);
+
+//Appends the visible, clipped triangles of every instance, in instance order, and returns
+//how many were written. Instances outside the frustum are skipped before any vertex work.
+//capacity = n_instances * n_faces * MAX_CLIPPED_TRIANGLES can never overflow.
+//With a light the triangles carry the shaded instance color, without one every face is kept.
+//Scratch comes from arena and the culled instances and faces are added to stats
+int project_mesh_instances(const mesh_t* mesh, const instance_t* instances, int n_instances, projection_t projection, const light_t* light, triangle_t* triangles_out, int capacity, arena_t* arena, struct cull_stats* stats);
+
+//Scales each channel, the alpha byte is kept
+uint32_t shade_color(uint32_t color, float intensity);
+
+#endif
@@ -0,0 +1,96 @@
+#include "layer.h"
+#include <stdlib.h>
+#include <string.h>
+
+static layer_t layers[N_LAYERS];
+static int layer_width = 0;
+static int layer_height = 0;
+
+layer_stats_t layer_stats = { 0 };
+
+bool init_layers(int width, int height) {
+    layer_width = width;
+    layer_height = height;
+    for (int i = 0; i < N_LAYERS; i++) {
+        layer_t empty = { 0 };
+        layers[i] = empty;
+        layers[i].pixels = (uint32_t*)calloc((size_t)width * height, sizeof(uint32_t));
+        if (!layers[i].pixels) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void free_layers(void) {
+    for (int i = 0; i < N_LAYERS; i++) {
+        free(layers[i].pixels);
+        free_command_buffer(&layers[i].recorded[0]);
+        free_command_buffer(&layers[i].recorded[1]);
+        layers[i].pixels = NULL;
+    }
+}
+
+//Band of the commands clipped to the surface, empty when top >= bottom
+static void covered_rows(const command_buffer_t* commands, int height, int* top, int* bottom) {
+    *top = commands->top > 0 ? commands->top : 0;
+    *bottom = commands->bottom < height ? commands->bottom : height;
+}
+
+void composite_commands(framebuffer_t* framebuffer, command_buffer_t* commands, uint32_t* surface) {
+    int top, bottom;
+    covered_rows(commands, framebuffer->height, &top, &bottom);
+    if (top >= bottom) {
+        return;
+    }
+
+    size_t row_pixels = (size_t)framebuffer->width;
+    memset(surface + top * row_pixels, 0, (bottom - top) * row_pixels * sizeof(uint32_t));
+    framebuffer_t target = { surface, framebuffer->width, framebuffer->height, framebuffer->antialiased_lines };
+    draw_command_buffer(commands, &target);
+    raster_composite_rows(framebuffer, surface, top, bottom);
+}
+
+void composite_layers(framebuffer_t* framebuffer, command_buffer_t recorded_layers[N_LAYERS], const bool used[N_LAYERS]) {
+    layer_stats_t empty = { 0 };
+    layer_stats = empty;
+
+    for (int i = 0; i < N_LAYERS; i++) {
+        layer_t* layer = &layers[i];
+        if (!used[i] || !layer->pixels) {
+            continue;
+        }
+
+        //The recorder gets the buffer of two frames ago to record into next
+        command_buffer_t swapped = layer->recorded[layer->current];
+        layer->recorded[layer->current] = recorded_layers[i];
+        recorded_layers[i] = swapped;
+
+        command_buffer_t* recorded = &layer->recorded[layer->current];
+        command_buffer_t* drawn = &layer->recorded[1 - layer->current];
+        if (layer->valid && layer->antialiased == framebuffer->antialiased_lines && command_buffers_equal(recorded, drawn)) {
+            layer_stats.reused++;
+        }
+        else {
+            //Only the old drawing needs erasing, everything else is still transparent
+            size_t row_pixels = (size_t)layer_width;
+            if (layer->drawn_top < layer->drawn_bottom) {
+                memset(layer->pixels + layer->drawn_top * row_pixels, 0, (layer->drawn_bottom - layer->drawn_top) * row_pixels * sizeof(uint32_t));
+            }
+            covered_rows(recorded, layer_height, &layer->drawn_top, &layer->drawn_bottom);
+
+            framebuffer_t surface = { layer->pixels, layer_width, layer_height, framebuffer->antialiased_lines };
+            draw_command_buffer(recorded, &surface);
+            layer->valid = true;
+            layer->antialiased = framebuffer->antialiased_lines;
+            layer_stats.redrawn++;
+        }
+
+        //What was just recorded becomes what the pixels were drawn from
+        layer->current = 1 - layer->current;
+
+        if (layer->drawn_top < layer->drawn_bottom) {
+            raster_composite_rows(framebuffer, layer->pixels, layer->drawn_top, layer->drawn_bottom);
+        }
+    }
+}
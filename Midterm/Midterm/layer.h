@@ -0,0 +1,45 @@
+#ifndef LAYER_H
+#define LAYER_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "raster.h"
+#include "command.h"
+
+//Cached surfaces under the per-frame foreground, composited in this order.
+//Only worth it for content that records the same commands for several frames in a row
+typedef enum {
+    LAYER_SCENERY,
+    N_LAYERS
+} layer_id_t;
+
+typedef struct {
+    uint32_t* pixels; //ARGB whatever the frame format, 0 is transparent
+    command_buffer_t recorded[2]; //this frame and the one the pixels were drawn from
+    int current;
+    bool valid; //pixels match recorded[1 - current]
+    bool antialiased; //line mode the pixels were drawn in
+    int drawn_top; //rows holding the drawing, the rest of the surface is transparent
+    int drawn_bottom;
+} layer_t;
+
+typedef struct {
+    int redrawn;
+    int reused;
+} layer_stats_t;
+
+//Layers of the last composite_layers() call, shown on the HUD
+extern layer_stats_t layer_stats;
+
+bool init_layers(int width, int height);
+void free_layers(void);
+
+//Swaps the commands of every used layer in, handing back a spare buffer in their place,
+//re-rasterizes those that differ from their last drawing and composites them.
+//Clearing, drawing and compositing all stay within the rows the commands cover
+void composite_layers(framebuffer_t* framebuffer, command_buffer_t recorded_layers[N_LAYERS], const bool used[N_LAYERS]);
+
+//Uncached: draws the commands onto a scratch ARGB surface of the framebuffer's size and composites
+//them, touching only the rows they cover. The surface needs no clearing beforehand
+void composite_commands(framebuffer_t* framebuffer, command_buffer_t* commands, uint32_t* surface);
+
+#endif
@@ -1,4 +1,5 @@
 #include "mesh.h"
+#include <math.h>
 
 //vertices for a square pyramid
 vec3_t mesh_vertices[N_MESH_VERTICES] = {
@@ -23,6 +24,8 @@ face_t mesh_faces[N_MESH_FACES] = {
     {.a = 5, .b = 2, .c = 0}  
 };
 
+vec3_t mesh_normals[N_MESH_FACES];
+
 //vertices for an octahedron
 vec3_t mesh2_vertices[N_MESH2_VERTICES] = {
     {.x = 0, .y = 1, .z = 0},   // Top vertex 0
@@ -45,6 +48,8 @@ face_t mesh2_faces[N_MESH2_FACES] = {
     {.a = 4, .b = 1, .c = 5}   
 };
 
+vec3_t mesh2_normals[N_MESH2_FACES];
+
 // Vertices for a triangular pyramid
 vec3_t mesh3_vertices[N_MESH3_VERTICES] = {
     {.x = 0, .y = 1, .z = 0},   // Top vertex 0
@@ -61,3 +66,78 @@ face_t mesh3_faces[N_MESH3_FACES] = {
     {.a = 1, .b = 2, .c = 3}  
 };
 
+vec3_t mesh3_normals[N_MESH3_FACES];
+
+mesh_t square_pyramid_mesh = { mesh_vertices, N_MESH_VERTICES, mesh_faces, N_MESH_FACES, mesh_normals, 1 };
+mesh_t octahedron_mesh = { mesh2_vertices, N_MESH2_VERTICES, mesh2_faces, N_MESH2_FACES, mesh2_normals, 0 };
+mesh_t triangular_pyramid_mesh = { mesh3_vertices, N_MESH3_VERTICES, mesh3_faces, N_MESH3_FACES, mesh3_normals, 0 };
+
+int mesh_vertex_index(const mesh_t* mesh, int corner) {
+    int index = (corner - mesh->index_base) % mesh->n_vertices;
+    return index < 0 ? index + mesh->n_vertices : index;
+}
+
+//Bounding sphere around the center of the vertex box
+void compute_mesh_bounds(mesh_t* mesh) {
+    vec3_t min = mesh->vertices[0];
+    vec3_t max = mesh->vertices[0];
+    for (int i = 1; i < mesh->n_vertices; i++) {
+        vec3_t v = mesh->vertices[i];
+        min.x = v.x < min.x ? v.x : min.x;
+        min.y = v.y < min.y ? v.y : min.y;
+        min.z = v.z < min.z ? v.z : min.z;
+        max.x = v.x > max.x ? v.x : max.x;
+        max.y = v.y > max.y ? v.y : max.y;
+        max.z = v.z > max.z ? v.z : max.z;
+    }
+
+    vec3_t center = {
+        .x = (min.x + max.x) / 2,
+        .y = (min.y + max.y) / 2,
+        .z = (min.z + max.z) / 2
+    };
+
+    float radius_squared = 0;
+    for (int i = 0; i < mesh->n_vertices; i++) {
+        float dx = mesh->vertices[i].x - center.x;
+        float dy = mesh->vertices[i].y - center.y;
+        float dz = mesh->vertices[i].z - center.z;
+        float distance_squared = dx * dx + dy * dy + dz * dz;
+        if (distance_squared > radius_squared) {
+            radius_squared = distance_squared;
+        }
+    }
+
+    mesh->bound_center = center;
+    mesh->bound_radius = sqrtf(radius_squared);
+}
+
+void compute_mesh_normals(mesh_t* mesh) {
+    vec3_t center = { 0, 0, 0 };
+    for (int i = 0; i < mesh->n_vertices; i++) {
+        center.x += mesh->vertices[i].x / mesh->n_vertices;
+        center.y += mesh->vertices[i].y / mesh->n_vertices;
+        center.z += mesh->vertices[i].z / mesh->n_vertices;
+    }
+
+    for (int f = 0; f < mesh->n_faces; f++) {
+        vec3_t a = mesh->vertices[mesh_vertex_index(mesh, mesh->faces[f].a)];
+        vec3_t b = mesh->vertices[mesh_vertex_index(mesh, mesh->faces[f].b)];
+        vec3_t c = mesh->vertices[mesh_vertex_index(mesh, mesh->faces[f].c)];
+
+        vec3_t ab = { b.x - a.x, b.y - a.y, b.z - a.z };
+        vec3_t ac = { c.x - a.x, c.y - a.y, c.z - a.z };
+        vec3_t normal = {
+            .x = ab.y * ac.z - ab.z * ac.y,
+            .y = ab.z * ac.x - ab.x * ac.z,
+            .z = ab.x * ac.y - ab.y * ac.x
+        };
+
+        float length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        float outward = normal.x * (a.x - center.x) + normal.y * (a.y - center.y) + normal.z * (a.z - center.z);
+        float scale = length > 0 ? (outward < 0 ? -1 : 1) / length : 0;
+
+        vec3_t unit = { normal.x * scale, normal.y * scale, normal.z * scale };
+        mesh->normals[f] = unit;
+    }
+}
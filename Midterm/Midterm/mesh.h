@@ -3,6 +3,17 @@
 #include "vector.h"
 #include "triangle.h"
 
+typedef struct {
+    vec3_t* vertices;
+    int n_vertices;
+    face_t* faces;
+    int n_faces;
+    vec3_t* normals; //one per face, filled by compute_mesh_normals()
+    int index_base; //first vertex index used by the faces (1 for the square pyramid)
+    vec3_t bound_center;
+    float bound_radius; //0 until compute_mesh_bounds() runs, never culled before that
+} mesh_t;
+
 //Square pyramid
 #define N_MESH_VERTICES 5
 
@@ -11,6 +22,7 @@ extern vec3_t mesh_vertices[N_MESH_VERTICES];
 #define N_MESH_FACES 8
 
 extern face_t mesh_faces[N_MESH_FACES];
+extern vec3_t mesh_normals[N_MESH_FACES];
 
 //Octahedron
 #define N_MESH2_VERTICES 6  
@@ -20,6 +32,7 @@ extern vec3_t mesh2_vertices[N_MESH2_VERTICES];
 #define N_MESH2_FACES 8      
 
 extern face_t mesh2_faces[N_MESH2_FACES];
+extern vec3_t mesh2_normals[N_MESH2_FACES];
 
 
 //Triangular pyramid
@@ -30,5 +43,19 @@ extern vec3_t mesh3_vertices[N_MESH3_VERTICES];
 #define N_MESH3_FACES 4
 
 extern face_t mesh3_faces[N_MESH3_FACES];
+extern vec3_t mesh3_normals[N_MESH3_FACES];
+
+extern mesh_t square_pyramid_mesh;
+extern mesh_t octahedron_mesh;
+extern mesh_t triangular_pyramid_mesh;
+
+void compute_mesh_bounds(mesh_t* mesh);
+
+//Unit normals pointing away from the vertex average, so the winding of the faces does not matter.
+//Meant for convex meshes, degenerate faces get a zero normal
+void compute_mesh_normals(mesh_t* mesh);
+
+//Face corner to vertex array index. The square pyramid mixes 0 with 1-based indices, so it wraps
+int mesh_vertex_index(const mesh_t* mesh, int corner);
 
 #endif
\ No newline at end of file
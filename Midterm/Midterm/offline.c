@@ -0,0 +1,172 @@
+#include "offline.h"
+#include "raster.h"
+#include "command.h"
+#include "layer.h"
+#include "recorder.h"
+#include <SDL.h>
+#include <windows.h>
+#include <stdlib.h>
+
+//Framebuffers per worker, so a worker can start its next frame while the last one waits for its turn
+#define OFFLINE_SLOTS_PER_THREAD 2
+
+typedef struct {
+    const offline_job_t* job;
+    CRITICAL_SECTION output_lock; //everything below
+    CONDITION_VARIABLE slot_freed;
+    LONG volatile next_frame;
+    int next_output;
+    int n_slots;
+    uint32_t** slots; //frame i renders into slots[i % n_slots]
+    bool* finished;
+} offline_state_t;
+
+typedef struct {
+    offline_state_t* state;
+    recorder_t recorder;
+    uint32_t* layer_surface;
+} offline_worker_t;
+
+int offline_thread_count(void) {
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    int n_threads = (int)system_info.dwNumberOfProcessors;
+    if (n_threads < 1) {
+        return 1;
+    }
+    return n_threads > MAX_OFFLINE_THREADS ? MAX_OFFLINE_THREADS : n_threads;
+}
+
+static void render_frame(offline_worker_t* worker, uint32_t* pixels) {
+    const offline_job_t* job = worker->state->job;
+    recorder_t* recorder = &worker->recorder;
+    framebuffer_t framebuffer = { pixels, job->width, job->height, job->antialiased_lines };
+
+    //Same order as the live pipeline, without the cache the live layers keep between frames
+    raster_clear(&framebuffer, recorder->commands.clear_color);
+    for (int i = 0; i < N_LAYERS; i++) {
+        if (recorder->layer_used[i]) {
+            composite_commands(&framebuffer, &recorder->layer_commands[i], worker->layer_surface);
+        }
+    }
+    draw_command_buffer(&recorder->commands, &framebuffer);
+}
+
+static DWORD WINAPI offline_worker(LPVOID param) {
+    offline_worker_t* worker = (offline_worker_t*)param;
+    offline_state_t* state = worker->state;
+    const offline_job_t* job = state->job;
+
+    for (;;) {
+        int frame = (int)InterlockedIncrement(&state->next_frame) - 1;
+        if (frame >= job->n_frames) {
+            break;
+        }
+        int slot = frame % state->n_slots;
+
+        //The slot holds frame - n_slots until that one has been written
+        EnterCriticalSection(&state->output_lock);
+        while (state->next_output <= frame - state->n_slots) {
+            SleepConditionVariableCS(&state->slot_freed, &state->output_lock, INFINITE);
+        }
+        LeaveCriticalSection(&state->output_lock);
+
+        //The commands hold copies of everything they draw, so the arena is done with once recorded
+        job->record(&worker->recorder, (uint32_t)frame * job->frame_ms, job->user);
+        arena_reset(&worker->recorder.arena);
+
+        render_frame(worker, state->slots[slot]);
+
+        //Whoever finishes the oldest outstanding frame writes it and every finished one after it
+        EnterCriticalSection(&state->output_lock);
+        state->finished[slot] = true;
+        while (state->next_output < job->n_frames && state->finished[state->next_output % state->n_slots]) {
+            int ready = state->next_output % state->n_slots;
+            if (job->output) {
+                job->output(state->next_output, state->slots[ready], job->width, job->height, job->user);
+            }
+            state->finished[ready] = false;
+            state->next_output++;
+        }
+        WakeAllConditionVariable(&state->slot_freed);
+        LeaveCriticalSection(&state->output_lock);
+    }
+    return 0;
+}
+
+static void free_offline_buffers(offline_state_t* state, offline_worker_t* workers, int n_threads) {
+    if (state->slots) {
+        for (int i = 0; i < state->n_slots; i++) {
+            free(state->slots[i]);
+        }
+    }
+    free(state->slots);
+    free(state->finished);
+
+    if (workers) {
+        for (int w = 0; w < n_threads; w++) {
+            free_recorder(&workers[w].recorder);
+            free(workers[w].layer_surface);
+        }
+    }
+    free(workers);
+}
+
+double render_offline(const offline_job_t* job) {
+    int n_threads = job->n_threads < 1 ? 1 : job->n_threads > MAX_OFFLINE_THREADS ? MAX_OFFLINE_THREADS : job->n_threads;
+    size_t frame_bytes = (size_t)job->width * job->height * sizeof(uint32_t);
+
+    offline_state_t state = { 0 };
+    state.job = job;
+    state.n_slots = n_threads * OFFLINE_SLOTS_PER_THREAD;
+    state.slots = (uint32_t**)calloc(state.n_slots, sizeof(uint32_t*));
+    state.finished = (bool*)calloc(state.n_slots, sizeof(bool));
+    offline_worker_t* workers = (offline_worker_t*)calloc(n_threads, sizeof(offline_worker_t));
+
+    bool allocated = state.slots && state.finished && workers;
+    for (int i = 0; allocated && i < state.n_slots; i++) {
+        state.slots[i] = (uint32_t*)malloc(frame_bytes);
+        allocated = state.slots[i] != NULL;
+    }
+    for (int w = 0; allocated && w < n_threads; w++) {
+        workers[w].state = &state;
+        workers[w].layer_surface = (uint32_t*)malloc(frame_bytes);
+        allocated = workers[w].layer_surface != NULL && init_recorder(&workers[w].recorder);
+        if (allocated && job->prepare) {
+            allocated = job->prepare(&workers[w].recorder, job->user);
+        }
+    }
+    if (!allocated) {
+        free_offline_buffers(&state, workers, n_threads);
+        return -1.0;
+    }
+
+    InitializeCriticalSection(&state.output_lock);
+    InitializeConditionVariable(&state.slot_freed);
+
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    //Frames are pulled, so a worker that fails to start only costs its share of the speedup
+    HANDLE threads[MAX_OFFLINE_THREADS];
+    int started = 0;
+    for (int w = 1; w < n_threads; w++) {
+        threads[started] = CreateThread(NULL, 0, offline_worker, &workers[w], 0, NULL);
+        if (threads[started]) {
+            started++;
+        }
+    }
+    offline_worker(&workers[0]);
+
+    if (started > 0) {
+        WaitForMultipleObjects(started, threads, TRUE, INFINITE);
+        for (int t = 0; t < started; t++) {
+            CloseHandle(threads[t]);
+        }
+    }
+
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    DeleteCriticalSection(&state.output_lock);
+    free_offline_buffers(&state, workers, n_threads);
+    return seconds;
+}
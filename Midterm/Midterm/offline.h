@@ -0,0 +1,40 @@
+#ifndef OFFLINE_H
+#define OFFLINE_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "recorder.h"
+
+#define MAX_OFFLINE_THREADS 64
+
+//Sets up a worker's recorder before its first frame, e.g. builds its scene graph
+typedef bool (*offline_prepare_t)(recorder_t* recorder, void* user);
+
+//Records the frame at scene_time into the worker's recorder. Workers record at the same time,
+//each into its own recorder, so nothing else may be written and nothing may carry over from earlier frames
+typedef void (*offline_record_t)(recorder_t* recorder, uint32_t scene_time, void* user);
+
+//Receives finished ARGB frames in frame order, the pixels are only valid during the call
+typedef void (*offline_output_t)(int frame, const uint32_t* pixels, int width, int height, void* user);
+
+typedef struct {
+    int width;
+    int height;
+    int n_frames; //frame i is recorded at scene time i * frame_ms
+    uint32_t frame_ms;
+    int n_threads;
+    bool antialiased_lines;
+    offline_prepare_t prepare; //may be NULL
+    offline_record_t record;
+    offline_output_t output; //may be NULL
+    void* user;
+} offline_job_t;
+
+//Logical processors, at most MAX_OFFLINE_THREADS
+int offline_thread_count(void);
+
+//Workers pull frame indices in order, record and rasterize them in parallel, each into its own
+//pair of framebuffers, then hand them to output in order.
+//Returns the wall time in seconds, or a negative value if the workers could not be set up
+double render_offline(const offline_job_t* job);
+
+#endif
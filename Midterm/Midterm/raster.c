@@ -0,0 +1,698 @@
+#include "raster.h"
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <emmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+static uint16_t rgb565(uint32_t color) {
+    return (uint16_t)(((color >> 8) & 0xF800) | ((color >> 5) & 0x07E0) | ((color >> 3) & 0x001F));
+}
+
+static uint32_t argb_from_rgb565(uint16_t pixel) {
+    uint32_t r = (pixel >> 11) & 0x1F, g = (pixel >> 5) & 0x3F, b = pixel & 0x1F;
+    return 0xFF000000 | (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+}
+
+static uint8_t palette_index(palette_t* palette, uint32_t color) {
+    for (int i = 0; i < palette->count; i++) {
+        if (palette->colors[i] == color) {
+            return (uint8_t)i;
+        }
+    }
+    if (palette->count < 256) {
+        palette->colors[palette->count] = color;
+        return (uint8_t)palette->count++;
+    }
+
+    int nearest = 0;
+    int nearest_distance = 0x7FFFFFFF;
+    for (int i = 0; i < 256; i++) {
+        int dr = (int)((color >> 16) & 0xFF) - (int)((palette->colors[i] >> 16) & 0xFF);
+        int dg = (int)((color >> 8) & 0xFF) - (int)((palette->colors[i] >> 8) & 0xFF);
+        int db = (int)(color & 0xFF) - (int)(palette->colors[i] & 0xFF);
+        int distance = dr * dr + dg * dg + db * db;
+        if (distance < nearest_distance) {
+            nearest = i;
+            nearest_distance = distance;
+        }
+    }
+    return (uint8_t)nearest;
+}
+
+//ARGB to the value stored in the framebuffer
+static uint32_t encode_color(framebuffer_t* framebuffer, uint32_t color) {
+    switch (framebuffer->format) {
+    case PIXEL_RGB565:
+        return rgb565(color);
+    case PIXEL_INDEXED8:
+        return palette_index(framebuffer->palette, color);
+    default:
+        return color;
+    }
+}
+
+static uint32_t read_argb(const framebuffer_t* framebuffer, size_t index) {
+    switch (framebuffer->format) {
+    case PIXEL_RGB565:
+        return argb_from_rgb565(((const uint16_t*)framebuffer->pixels)[index]);
+    case PIXEL_INDEXED8:
+        return framebuffer->palette->colors[((const uint8_t*)framebuffer->pixels)[index]];
+    default:
+        return ((const uint32_t*)framebuffer->pixels)[index];
+    }
+}
+
+static void put_pixel(framebuffer_t* framebuffer, size_t index, uint32_t value) {
+    framebuffer->pixels_written++;
+    switch (framebuffer->format) {
+    case PIXEL_RGB565:
+        ((uint16_t*)framebuffer->pixels)[index] = (uint16_t)value;
+        break;
+    case PIXEL_INDEXED8:
+        ((uint8_t*)framebuffer->pixels)[index] = (uint8_t)value;
+        break;
+    default:
+        ((uint32_t*)framebuffer->pixels)[index] = value;
+        break;
+    }
+}
+
+//16 bytes per store whatever the format
+static void fill_span(framebuffer_t* framebuffer, size_t index, size_t count, uint32_t value) {
+    size_t i = 0;
+    framebuffer->pixels_written += count;
+    if (framebuffer->format == PIXEL_RGB565) {
+        uint16_t* pixels = (uint16_t*)framebuffer->pixels + index;
+        __m128i fill = _mm_set1_epi16((short)value);
+        for (; i + 8 <= count; i += 8) {
+            _mm_storeu_si128((__m128i*)(pixels + i), fill);
+        }
+        for (; i < count; i++) {
+            pixels[i] = (uint16_t)value;
+        }
+    }
+    else if (framebuffer->format == PIXEL_INDEXED8) {
+        uint8_t* pixels = (uint8_t*)framebuffer->pixels + index;
+        __m128i fill = _mm_set1_epi8((char)value);
+        for (; i + 16 <= count; i += 16) {
+            _mm_storeu_si128((__m128i*)(pixels + i), fill);
+        }
+        for (; i < count; i++) {
+            pixels[i] = (uint8_t)value;
+        }
+    }
+    else {
+        uint32_t* pixels = (uint32_t*)framebuffer->pixels + index;
+        __m128i fill = _mm_set1_epi32((int)value);
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_si128((__m128i*)(pixels + i), fill);
+        }
+        for (; i < count; i++) {
+            pixels[i] = value;
+        }
+    }
+}
+
+void raster_clear(framebuffer_t* framebuffer, uint32_t color) {
+    if (framebuffer->format == PIXEL_INDEXED8) {
+        framebuffer->palette->count = 0;
+    }
+    framebuffer->pixels_written = 0;
+    fill_span(framebuffer, 0, (size_t)framebuffer->width * framebuffer->height, encode_color(framebuffer, color));
+}
+
+//value is already encoded
+static void plot(framebuffer_t* framebuffer, int x, int y, uint32_t value) {
+    if ((unsigned)x < (unsigned)framebuffer->width && (unsigned)y < (unsigned)framebuffer->height) {
+        put_pixel(framebuffer, (size_t)y * framebuffer->width + x, value);
+    }
+}
+
+void raster_pixel(framebuffer_t* framebuffer, int x, int y, uint32_t color) {
+    plot(framebuffer, x, y, encode_color(framebuffer, color));
+}
+
+void raster_line(framebuffer_t* framebuffer, int x0, int y0, int x1, int y1, uint32_t color) {
+    if (framebuffer->antialiased_lines) {
+        raster_line_aa(framebuffer, (float)x0, (float)y0, (float)x1, (float)y1, color);
+        return;
+    }
+
+    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy, e2;
+    uint32_t value = encode_color(framebuffer, color);
+
+    for (;;) {
+        plot(framebuffer, x0, y0, value);
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        e2 = 2 * err;
+
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+//dst = (color * a + dst * (256 - a)) >> 8 per channel, both ARGB pixels in one register, each weighted
+//by its 16-bit lanes of alpha. color holds the line color twice in 16-bit lanes. The result is packed
+static __m128i blend_argb_pair(uint32_t first, uint32_t second, __m128i alpha, __m128i color) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i dst = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128((int)first), _mm_cvtsi32_si128((int)second)), zero);
+    __m128i blended = _mm_add_epi16(_mm_mullo_epi16(color, alpha), _mm_mullo_epi16(dst, _mm_sub_epi16(_mm_set1_epi16(256), alpha)));
+    return _mm_packus_epi16(_mm_srli_epi16(blended, 8), zero);
+}
+
+//first_alpha for the first pixel, the rest of the coverage for the second
+static __m128i pair_weights(int first_alpha) {
+    return _mm_unpacklo_epi64(_mm_set1_epi16((short)first_alpha), _mm_set1_epi16((short)(256 - first_alpha)));
+}
+
+//Any format, converted through ARGB
+static void blend_pair(framebuffer_t* framebuffer, size_t first, size_t second, int first_alpha, __m128i color) {
+    __m128i packed = blend_argb_pair(read_argb(framebuffer, first), read_argb(framebuffer, second), pair_weights(first_alpha), color);
+    put_pixel(framebuffer, first, encode_color(framebuffer, (uint32_t)_mm_cvtsi128_si32(packed)));
+    put_pixel(framebuffer, second, encode_color(framebuffer, (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(packed, 4))));
+}
+
+//The half of a pair that is still on screen
+static void blend_single(framebuffer_t* framebuffer, size_t pixel, int alpha, __m128i color) {
+    __m128i packed = blend_argb_pair(read_argb(framebuffer, pixel), 0, _mm_set1_epi16((short)alpha), color);
+    put_pixel(framebuffer, pixel, encode_color(framebuffer, (uint32_t)_mm_cvtsi128_si32(packed)));
+}
+
+//The walk of raster_line_aa() straight on 32-bit pixels, with no format switch per pixel
+static void line_aa_argb(framebuffer_t* framebuffer, int first, int last, float intery, float gradient, bool steep, __m128i color) {
+    uint32_t* pixels = (uint32_t*)framebuffer->pixels;
+    int minor_limit = steep ? framebuffer->width : framebuffer->height;
+    int minor_step = steep ? 1 : framebuffer->width;
+    uint64_t written = 0;
+
+    for (int x = first; x <= last; x++, intery += gradient) {
+        int y = (int)intery - (intery < (int)intery);
+        if (y < -1 || y >= minor_limit) {
+            continue;
+        }
+
+        int alpha = (int)((intery - y) * 256 + 0.5f);
+        int row = steep ? x : (y < 0 ? 0 : y);
+        int column = steep ? (y < 0 ? 0 : y) : x;
+        uint32_t* pixel = pixels + (size_t)row * framebuffer->width + column;
+
+        if (y < 0) {
+            *pixel = (uint32_t)_mm_cvtsi128_si32(blend_argb_pair(*pixel, 0, _mm_set1_epi16((short)alpha), color));
+            written++;
+        }
+        else if (y == minor_limit - 1) {
+            *pixel = (uint32_t)_mm_cvtsi128_si32(blend_argb_pair(*pixel, 0, _mm_set1_epi16((short)(256 - alpha)), color));
+            written++;
+        }
+        else {
+            __m128i packed = blend_argb_pair(pixel[0], pixel[minor_step], pair_weights(256 - alpha), color);
+            pixel[0] = (uint32_t)_mm_cvtsi128_si32(packed);
+            pixel[minor_step] = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(packed, 4));
+            written += 2;
+        }
+    }
+    framebuffer->pixels_written += written;
+}
+
+void raster_line_aa(framebuffer_t* framebuffer, float x0, float y0, float x1, float y1, uint32_t color) {
+    //Walk the major axis as x
+    bool steep = fabsf(y1 - y0) > fabsf(x1 - x0);
+    if (steep) {
+        float t = x0; x0 = y0; y0 = t;
+        t = x1; x1 = y1; y1 = t;
+    }
+    if (x0 > x1) {
+        float t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+
+    float dx = x1 - x0;
+    float gradient = dx > 0 ? (y1 - y0) / dx : 1;
+
+    //Only the columns on screen, the guard band can put endpoints far outside
+    int major_limit = steep ? framebuffer->height : framebuffer->width;
+    int minor_limit = steep ? framebuffer->width : framebuffer->height;
+    int first = (int)floorf(x0 + 0.5f);
+    int last = (int)floorf(x1 + 0.5f);
+    first = first > 0 ? first : 0;
+    last = last < major_limit - 1 ? last : major_limit - 1;
+
+    //Next pixel along the minor axis
+    int minor_step = steep ? 1 : framebuffer->width;
+    __m128i line_color = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), _mm_setzero_si128());
+
+    float intery = y0 + gradient * (first - x0);
+    if (framebuffer->format == PIXEL_ARGB8888) {
+        line_aa_argb(framebuffer, first, last, intery, gradient, steep, line_color);
+        return;
+    }
+
+    //A palette can't hold every blended shade, so indexed targets only get the nearer pixel
+    bool blend = framebuffer->format != PIXEL_INDEXED8;
+    uint32_t value = encode_color(framebuffer, color);
+
+    for (int x = first; x <= last; x++, intery += gradient) {
+        int y = (int)intery - (intery < (int)intery);
+        if (y < -1 || y >= minor_limit) {
+            continue;
+        }
+
+        //The pair straddles the line, the nearer pixel gets more of the color
+        int alpha = (int)((intery - y) * 256 + 0.5f);
+        int row = steep ? x : (y < 0 ? 0 : y);
+        int column = steep ? (y < 0 ? 0 : y) : x;
+        size_t pixel = (size_t)row * framebuffer->width + column;
+
+        if (!blend) {
+            if (alpha < 128 && y >= 0) {
+                put_pixel(framebuffer, pixel, value);
+            }
+            else if (alpha >= 128 && y < minor_limit - 1) {
+                put_pixel(framebuffer, y < 0 ? pixel : pixel + minor_step, value);
+            }
+        }
+        else if (y < 0) {
+            blend_single(framebuffer, pixel, alpha, line_color);
+        }
+        else if (y == minor_limit - 1) {
+            blend_single(framebuffer, pixel, 256 - alpha, line_color);
+        }
+        else {
+            blend_pair(framebuffer, pixel, pixel + minor_step, 256 - alpha, line_color);
+        }
+    }
+}
+
+void raster_triangle(framebuffer_t* framebuffer, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color) {
+    raster_line(framebuffer, x0, y0, x1, y1, color);
+    raster_line(framebuffer, x1, y1, x2, y2, color);
+    raster_line(framebuffer, x2, y2, x0, y0, color);
+}
+
+//Pixel centers of the row in [left, right), clipped to the framebuffer
+static void fill_row_span(framebuffer_t* framebuffer, int row, float left, float right, uint32_t value) {
+    int span_begin = (int)ceilf(left - 0.5f);
+    int span_end = (int)ceilf(right - 0.5f);
+    span_begin = span_begin > 0 ? span_begin : 0;
+    span_end = span_end < framebuffer->width ? span_end : framebuffer->width;
+    if (span_begin < span_end) {
+        fill_span(framebuffer, (size_t)row * framebuffer->width + span_begin, span_end - span_begin, value);
+    }
+}
+
+//x where the edge a -> b crosses the row, b.y != a.y
+static float edge_x_at(float ax, float ay, float bx, float by, float y) {
+    return ax + (bx - ax) * (y - ay) / (by - ay);
+}
+
+void raster_fill_triangle(framebuffer_t* framebuffer, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color) {
+    //Sort by y, then the long edge 0 -> 2 is one side of every span
+    if (y1 < y0) { int t = x0; x0 = x1; x1 = t; t = y0; y0 = y1; y1 = t; }
+    if (y2 < y0) { int t = x0; x0 = x2; x2 = t; t = y0; y0 = y2; y2 = t; }
+    if (y2 < y1) { int t = x1; x1 = x2; x2 = t; t = y1; y1 = y2; y2 = t; }
+    if (y0 == y2) {
+        return;
+    }
+    uint32_t value = encode_color(framebuffer, color);
+
+    int first_row = y0 > 0 ? y0 : 0;
+    int last_row = y2 < framebuffer->height ? y2 : framebuffer->height;
+
+    for (int y = first_row; y < last_row; y++) {
+        float center_y = y + 0.5f;
+        float long_x = edge_x_at((float)x0, (float)y0, (float)x2, (float)y2, center_y);
+        float short_x = center_y < y1
+            ? edge_x_at((float)x0, (float)y0, (float)x1, (float)y1, center_y)
+            : edge_x_at((float)x1, (float)y1, (float)x2, (float)y2, center_y);
+
+        float left = long_x < short_x ? long_x : short_x;
+        float right = long_x < short_x ? short_x : long_x;
+        fill_row_span(framebuffer, y, left, right, value);
+    }
+}
+
+void raster_fill_rect(framebuffer_t* framebuffer, int x, int y, int width, int height, uint32_t color) {
+    int end_x = x + width < framebuffer->width ? x + width : framebuffer->width;
+    int end_y = y + height < framebuffer->height ? y + height : framebuffer->height;
+    x = x > 0 ? x : 0;
+    y = y > 0 ? y : 0;
+    if (x >= end_x) {
+        return;
+    }
+
+    uint32_t value = encode_color(framebuffer, color);
+    for (int row = y; row < end_y; row++) {
+        fill_span(framebuffer, (size_t)row * framebuffer->width + x, (size_t)(end_x - x), value);
+    }
+}
+
+void raster_rect(framebuffer_t* framebuffer, int x, int y, int width, int height, const uint32_t side_colors[4]) {
+    //Top
+    raster_line(framebuffer, x, y, x + width, y, side_colors[0]);
+    //Bottom
+    raster_line(framebuffer, x, y + height, x + width, y + height, side_colors[1]);
+    //Left
+    raster_line(framebuffer, x, y, x, y + height, side_colors[2]);
+    //Right
+    raster_line(framebuffer, x + width, y, x + width, y + height, side_colors[3]);
+}
+
+//Half width of the ellipse at row center y, negative when the row misses it
+static float ellipse_half_width(float center_y, float radius_x, float radius_y, float y) {
+    if (radius_x <= 0 || radius_y <= 0) {
+        return -1;
+    }
+    float dy = (y - center_y) / radius_y;
+    float t = 1 - dy * dy;
+    return t > 0 ? radius_x * sqrtf(t) : -1;
+}
+
+void raster_fill_ellipse(framebuffer_t* framebuffer, float x, float y, float radius_x, float radius_y, uint32_t color) {
+    if (!(radius_x > 0 && radius_y > 0)) {
+        return;
+    }
+
+    //Rows clipped once, columns once per span
+    int first_row = (int)ceilf(y - radius_y - 0.5f);
+    int end_row = (int)ceilf(y + radius_y - 0.5f);
+    first_row = first_row > 0 ? first_row : 0;
+    end_row = end_row < framebuffer->height ? end_row : framebuffer->height;
+    uint32_t value = encode_color(framebuffer, color);
+
+    for (int row = first_row; row < end_row; row++) {
+        float half_width = ellipse_half_width(y, radius_x, radius_y, row + 0.5f);
+        if (half_width >= 0) {
+            fill_row_span(framebuffer, row, x - half_width, x + half_width, value);
+        }
+    }
+}
+
+void raster_ellipse(framebuffer_t* framebuffer, float x, float y, float radius_x, float radius_y, uint32_t color) {
+    if (!(radius_x > 0 && radius_y > 0)) {
+        return;
+    }
+
+    //A one pixel ring centered on the curve: what is inside the outer ellipse but not the inner one
+    float outer_x = radius_x + 0.5f, outer_y = radius_y + 0.5f;
+    float inner_x = radius_x - 0.5f, inner_y = radius_y - 0.5f;
+
+    int first_row = (int)ceilf(y - outer_y - 0.5f);
+    int end_row = (int)ceilf(y + outer_y - 0.5f);
+    first_row = first_row > 0 ? first_row : 0;
+    end_row = end_row < framebuffer->height ? end_row : framebuffer->height;
+    uint32_t value = encode_color(framebuffer, color);
+
+    for (int row = first_row; row < end_row; row++) {
+        float outer = ellipse_half_width(y, outer_x, outer_y, row + 0.5f);
+        float inner = ellipse_half_width(y, inner_x, inner_y, row + 0.5f);
+        if (outer < 0) {
+            continue;
+        }
+        if (inner < 0) {
+            fill_row_span(framebuffer, row, x - outer, x + outer, value);
+            continue;
+        }
+        fill_row_span(framebuffer, row, x - outer, x - inner, value);
+        fill_row_span(framebuffer, row, x + inner, x + outer, value);
+    }
+}
+
+void raster_circle(framebuffer_t* framebuffer, float x, float y, float radius, uint32_t color) {
+    raster_ellipse(framebuffer, x, y, radius, radius, color);
+}
+
+void raster_star(framebuffer_t* framebuffer, int x, int y, int size, float angle, uint32_t color) {
+    //triangles vertices 4 triangle by 3*2 points
+    float vertices[4][6] = {
+        {x, y - size, x - size / 2, y + size / 2, x + size / 2, y + size / 2}, // Top triangle
+        {x, y + size, x - size / 2, y - size / 2, x + size / 2, y - size / 2}, // Bottom triangle
+        {x - size, y, x + size / 2, y - size / 2, x + size / 2, y + size / 2}, // Left triangle
+        {x + size, y, x - size / 2, y - size / 2, x - size / 2, y + size / 2}  // Right triangle
+    };
+    float cos_angle = cos(angle);
+    float sin_angle = sin(angle);
+
+    //rotation
+    for (int i = 0; i < 4; ++i) {
+        float rotated_vertices[6];
+        for (int j = 0; j < 6; ++j) {
+            if (j % 2 == 0) {
+                rotated_vertices[j] = x + (vertices[i][j] - x) * cos_angle - (vertices[i][j + 1] - y) * sin_angle;
+            }
+            else {
+                rotated_vertices[j] = y + (vertices[i][j] - y) * cos_angle + (vertices[i][j - 1] - x) * sin_angle;
+            }
+        }
+        raster_triangle(framebuffer, rotated_vertices[0], rotated_vertices[1], rotated_vertices[2], rotated_vertices[3], rotated_vertices[4], rotated_vertices[5], color);
+    }
+}
+
+void raster_polygon(framebuffer_t* framebuffer, const vec2_t* points, int n_points, uint32_t color) {
+    for (int i = 0; i < n_points; i++) {
+        vec2_t from = points[i];
+        vec2_t to = points[(i + 1) % n_points];
+        raster_line(framebuffer, from.x, from.y, to.x, to.y, color);
+    }
+}
+
+void raster_polyline(framebuffer_t* framebuffer, const vec2_t* points, int n_points, uint32_t color) {
+    for (int i = 0; i + 1 < n_points; i++) {
+        raster_line(framebuffer, points[i].x, points[i].y, points[i + 1].x, points[i + 1].y, color);
+    }
+}
+
+typedef struct {
+    int first_row;
+    int end_row; //exclusive
+    float x; //at the center of the current row
+    float dx; //per row
+} polygon_edge_t;
+
+//Polygons up to this many edges build their tables on the stack
+#define STACK_POLYGON_EDGES 32
+
+void raster_fill_polygon(framebuffer_t* framebuffer, const vec2_t* points, int n_points, uint32_t color) {
+    if (n_points < 3) {
+        return;
+    }
+
+    polygon_edge_t stack_edges[STACK_POLYGON_EDGES];
+    polygon_edge_t* stack_active[STACK_POLYGON_EDGES];
+    polygon_edge_t* edges = stack_edges;
+    polygon_edge_t** active = stack_active;
+    if (n_points > STACK_POLYGON_EDGES) {
+        edges = (polygon_edge_t*)malloc(n_points * sizeof(polygon_edge_t));
+        active = (polygon_edge_t**)malloc(n_points * sizeof(polygon_edge_t*));
+        if (!edges || !active) {
+            free(edges);
+            free(active);
+            return;
+        }
+    }
+
+    //Edge table, each edge covers the rows whose centers lie in [top, bottom)
+    int n_edges = 0;
+    int first_row = framebuffer->height;
+    int end_row = 0;
+    for (int i = 0; i < n_points; i++) {
+        vec2_t top = points[i];
+        vec2_t bottom = points[(i + 1) % n_points];
+        if (bottom.y < top.y) {
+            vec2_t t = top; top = bottom; bottom = t;
+        }
+
+        polygon_edge_t edge;
+        edge.first_row = (int)ceilf(top.y - 0.5f);
+        edge.end_row = (int)ceilf(bottom.y - 0.5f);
+        edge.first_row = edge.first_row > 0 ? edge.first_row : 0;
+        edge.end_row = edge.end_row < framebuffer->height ? edge.end_row : framebuffer->height;
+        if (edge.first_row >= edge.end_row) {
+            continue;
+        }
+        edge.dx = (bottom.x - top.x) / (bottom.y - top.y);
+        edge.x = top.x + (edge.first_row + 0.5f - top.y) * edge.dx;
+
+        //Insertion keeps the table sorted by first row
+        int slot = n_edges++;
+        while (slot > 0 && edges[slot - 1].first_row > edge.first_row) {
+            edges[slot] = edges[slot - 1];
+            slot--;
+        }
+        edges[slot] = edge;
+
+        first_row = edge.first_row < first_row ? edge.first_row : first_row;
+        end_row = edge.end_row > end_row ? edge.end_row : end_row;
+    }
+
+    uint32_t value = encode_color(framebuffer, color);
+    int next_edge = 0;
+    int n_active = 0;
+
+    for (int y = first_row; y < end_row; y++) {
+        //Retire finished edges, step the rest, then take in the ones starting here
+        int kept = 0;
+        for (int i = 0; i < n_active; i++) {
+            if (active[i]->end_row > y) {
+                active[kept++] = active[i];
+            }
+        }
+        n_active = kept;
+        while (next_edge < n_edges && edges[next_edge].first_row == y) {
+            active[n_active++] = &edges[next_edge++];
+        }
+
+        //Mostly sorted from the previous row, insertion sort is close to linear
+        for (int i = 1; i < n_active; i++) {
+            polygon_edge_t* edge = active[i];
+            int j = i;
+            while (j > 0 && active[j - 1]->x > edge->x) {
+                active[j] = active[j - 1];
+                j--;
+            }
+            active[j] = edge;
+        }
+
+        for (int i = 0; i + 1 < n_active; i += 2) {
+            fill_row_span(framebuffer, y, active[i]->x, active[i + 1]->x, value);
+        }
+
+        for (int i = 0; i < n_active; i++) {
+            active[i]->x += active[i]->dx;
+        }
+    }
+
+    if (edges != stack_edges) {
+        free(edges);
+        free(active);
+    }
+}
+
+void raster_composite(framebuffer_t* framebuffer, const uint32_t* argb_pixels) {
+    raster_composite_rows(framebuffer, argb_pixels, 0, framebuffer->height);
+}
+
+void raster_composite_rows(framebuffer_t* framebuffer, const uint32_t* argb_pixels, int first_row, int end_row) {
+    size_t first = (size_t)first_row * framebuffer->width;
+    size_t count = (size_t)end_row * framebuffer->width;
+    size_t i = first;
+    __m128i zero = _mm_setzero_si128();
+
+    if (framebuffer->format == PIXEL_ARGB8888) {
+        uint32_t* pixels = (uint32_t*)framebuffer->pixels;
+#ifdef __AVX2__
+        __m256i zero8 = _mm256_setzero_si256();
+        for (; i + 8 <= count; i += 8) {
+            __m256i s = _mm256_loadu_si256((const __m256i*)(argb_pixels + i));
+            __m256i d = _mm256_loadu_si256((const __m256i*)(pixels + i));
+            __m256i transparent = _mm256_cmpeq_epi32(s, zero8);
+            _mm256_storeu_si256((__m256i*)(pixels + i), _mm256_blendv_epi8(s, d, transparent));
+        }
+#endif
+        for (; i + 4 <= count; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i*)(argb_pixels + i));
+            __m128i d = _mm_loadu_si128((const __m128i*)(pixels + i));
+            __m128i transparent = _mm_cmpeq_epi32(s, zero);
+            _mm_storeu_si128((__m128i*)(pixels + i), _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, s)));
+        }
+    }
+    else if (framebuffer->format == PIXEL_RGB565) {
+        uint16_t* pixels = (uint16_t*)framebuffer->pixels;
+        __m128i red = _mm_set1_epi32(0xF800), green = _mm_set1_epi32(0x07E0), blue = _mm_set1_epi32(0x001F);
+        __m128i bias32 = _mm_set1_epi32(0x8000), bias16 = _mm_set1_epi16((short)0x8000);
+
+        //8 pixels per step, converted in 32-bit lanes then packed (biased, the pack saturates signed)
+        for (; i + 8 <= count; i += 8) {
+            __m128i s0 = _mm_loadu_si128((const __m128i*)(argb_pixels + i));
+            __m128i s1 = _mm_loadu_si128((const __m128i*)(argb_pixels + i + 4));
+            __m128i c0 = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(s0, 8), red), _mm_and_si128(_mm_srli_epi32(s0, 5), green)), _mm_and_si128(_mm_srli_epi32(s0, 3), blue));
+            __m128i c1 = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(s1, 8), red), _mm_and_si128(_mm_srli_epi32(s1, 5), green)), _mm_and_si128(_mm_srli_epi32(s1, 3), blue));
+            __m128i converted = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(c0, bias32), _mm_sub_epi32(c1, bias32)), bias16);
+            __m128i transparent = _mm_packs_epi32(_mm_cmpeq_epi32(s0, zero), _mm_cmpeq_epi32(s1, zero));
+
+            __m128i d = _mm_loadu_si128((const __m128i*)(pixels + i));
+            _mm_storeu_si128((__m128i*)(pixels + i), _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, converted)));
+        }
+    }
+
+    //The SIMD paths store every pixel they cover
+    framebuffer->pixels_written += i - first;
+
+    //Indexed targets and tails, the palette lookup only runs when the color changes
+    uint32_t last_color = 0;
+    uint32_t last_value = 0;
+    for (; i < count; i++) {
+        uint32_t color = argb_pixels[i];
+        if (color == 0) {
+            continue;
+        }
+        if (color != last_color) {
+            last_color = color;
+            last_value = encode_color(framebuffer, color);
+        }
+        put_pixel(framebuffer, i, last_value);
+    }
+}
+
+void raster_expand_to_argb(const framebuffer_t* framebuffer, uint32_t* out) {
+    size_t count = (size_t)framebuffer->width * framebuffer->height;
+    size_t i = 0;
+
+    if (framebuffer->format == PIXEL_ARGB8888) {
+        memcpy(out, framebuffer->pixels, count * sizeof(uint32_t));
+        return;
+    }
+
+    if (framebuffer->format == PIXEL_RGB565) {
+        const uint16_t* pixels = (const uint16_t*)framebuffer->pixels;
+        __m128i mask5 = _mm_set1_epi16(0x1F), mask6 = _mm_set1_epi16(0x3F), alpha = _mm_set1_epi16((short)0xFF00);
+
+        //8 pixels per step, channels widened to 8 bits by repeating their top bits
+        for (; i + 8 <= count; i += 8) {
+            __m128i p = _mm_loadu_si128((const __m128i*)(pixels + i));
+            __m128i r = _mm_srli_epi16(p, 11);
+            __m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask6);
+            __m128i b = _mm_and_si128(p, mask5);
+            r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+            g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+            b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+            __m128i green_blue = _mm_or_si128(_mm_slli_epi16(g, 8), b);
+            __m128i alpha_red = _mm_or_si128(alpha, r);
+            _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi16(green_blue, alpha_red));
+            _mm_storeu_si128((__m128i*)(out + i + 4), _mm_unpackhi_epi16(green_blue, alpha_red));
+        }
+        for (; i < count; i++) {
+            out[i] = argb_from_rgb565(pixels[i]);
+        }
+        return;
+    }
+
+    const uint8_t* pixels = (const uint8_t*)framebuffer->pixels;
+    const uint32_t* colors = framebuffer->palette->colors;
+#ifdef __AVX2__
+    for (; i + 8 <= count; i += 8) {
+        __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(pixels + i)));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_i32gather_epi32((const int*)colors, indices, 4));
+    }
+#endif
+    //No gather before AVX2, the lookups are scalar and the stores 4 wide
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(out + i), _mm_setr_epi32((int)colors[pixels[i]], (int)colors[pixels[i + 1]], (int)colors[pixels[i + 2]], (int)colors[pixels[i + 3]]));
+    }
+    for (; i < count; i++) {
+        out[i] = colors[pixels[i]];
+    }
+}
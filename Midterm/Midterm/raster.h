@@ -0,0 +1,74 @@
+#ifndef RASTER_H
+#define RASTER_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "vector.h"
+
+//Colors are always passed in as ARGB and converted once per primitive
+typedef enum {
+    PIXEL_ARGB8888,
+    PIXEL_RGB565, //alpha is dropped
+    PIXEL_INDEXED8, //index into the framebuffer's palette
+} pixel_format_t;
+
+//Filled in draw order and emptied by every clear. Once full, colors map to the nearest entry
+typedef struct {
+    uint32_t colors[256];
+    int count;
+} palette_t;
+
+typedef struct {
+    void* pixels; //width * height pixels of format
+    int width;
+    int height;
+    bool antialiased_lines; //every outline goes through raster_line_aa()
+    pixel_format_t format;
+    palette_t* palette; //PIXEL_INDEXED8 only
+    uint64_t pixels_written; //since the last clear, the clear included
+} framebuffer_t;
+
+//Also empties the palette
+void raster_clear(framebuffer_t* framebuffer, uint32_t color);
+void raster_pixel(framebuffer_t* framebuffer, int x, int y, uint32_t color);
+void raster_line(framebuffer_t* framebuffer, int x0, int y0, int x1, int y1, uint32_t color);
+
+//Xiaolin Wu's line, the two pixels straddling it at each step are blended by coverage
+void raster_line_aa(framebuffer_t* framebuffer, float x0, float y0, float x1, float y1, uint32_t color);
+void raster_triangle(framebuffer_t* framebuffer, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color);
+
+//Covers the pixels whose centers are inside, so triangles sharing an edge neither overlap nor leave gaps
+void raster_fill_triangle(framebuffer_t* framebuffer, int x0, int y0, int x1, int y1, int x2, int y2, uint32_t color);
+
+//Solid box clipped to the framebuffer, one span fill per row
+void raster_fill_rect(framebuffer_t* framebuffer, int x, int y, int width, int height, uint32_t color);
+
+//Top, bottom, left, right
+void raster_rect(framebuffer_t* framebuffer, int x, int y, int width, int height, const uint32_t side_colors[4]);
+//Radii may be fractional. Both emit horizontal spans, clipped once per span
+void raster_fill_ellipse(framebuffer_t* framebuffer, float x, float y, float radius_x, float radius_y, uint32_t color);
+
+//One pixel wide ring centered on the curve, two spans per row
+void raster_ellipse(framebuffer_t* framebuffer, float x, float y, float radius_x, float radius_y, uint32_t color);
+void raster_circle(framebuffer_t* framebuffer, float x, float y, float radius, uint32_t color);
+void raster_star(framebuffer_t* framebuffer, int x, int y, int size, float angle, uint32_t color);
+
+//Closed outline through every point
+void raster_polygon(framebuffer_t* framebuffer, const vec2_t* points, int n_points, uint32_t color);
+
+//Same without the closing edge
+void raster_polyline(framebuffer_t* framebuffer, const vec2_t* points, int n_points, uint32_t color);
+
+//Even-odd scanline fill with an active edge table, any vertex count, concave and self-intersecting included.
+//Covers pixel centers like raster_fill_triangle()
+void raster_fill_polygon(framebuffer_t* framebuffer, const vec2_t* points, int n_points, uint32_t color);
+
+//Copies the pixels of an ARGB surface that are not 0 (transparent), converting to the framebuffer format
+void raster_composite(framebuffer_t* framebuffer, const uint32_t* argb_pixels);
+
+//Same, limited to the rows first_row up to end_row, both already inside the framebuffer
+void raster_composite_rows(framebuffer_t* framebuffer, const uint32_t* argb_pixels, int first_row, int end_row);
+
+//For presenting, out holds width * height ARGB pixels
+void raster_expand_to_argb(const framebuffer_t* framebuffer, uint32_t* out);
+
+#endif
@@ -0,0 +1,54 @@
+#include "recorder.h"
+
+bool init_recorder(recorder_t* recorder) {
+    recorder_t empty = { 0 };
+    *recorder = empty;
+    recorder->active = &recorder->commands;
+    return arena_init(&recorder->arena, FRAME_ARENA_SIZE);
+}
+
+void free_recorder(recorder_t* recorder) {
+    free_command_buffer(&recorder->commands);
+    for (int i = 0; i < N_LAYERS; i++) {
+        free_command_buffer(&recorder->layer_commands[i]);
+    }
+    free_depth_list(&recorder->faces);
+    free_scene_graph(&recorder->scene);
+    arena_free(&recorder->arena);
+    recorder->active = &recorder->commands;
+}
+
+void clear_recorder(recorder_t* recorder, uint32_t clear_color) {
+    reset_command_buffer(&recorder->commands, clear_color);
+    for (int i = 0; i < N_LAYERS; i++) {
+        recorder->layer_used[i] = false;
+    }
+    reset_depth_list(&recorder->faces);
+}
+
+void begin_layer(recorder_t* recorder, layer_id_t id) {
+    if (!recorder->layer_used[id]) {
+        reset_command_buffer(&recorder->layer_commands[id], 0);
+        recorder->layer_used[id] = true;
+    }
+    recorder->active = &recorder->layer_commands[id];
+}
+
+void end_layer(recorder_t* recorder) {
+    recorder->active = &recorder->commands;
+}
+
+void seed_random(recorder_t* recorder, uint32_t seed) {
+    recorder->random_state = seed * 0x9E3779B9u;
+}
+
+uint32_t next_random(recorder_t* recorder) {
+    //Weyl sequence through a 32 bit integer hash
+    uint32_t x = recorder->random_state += 0x9E3779B9u;
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
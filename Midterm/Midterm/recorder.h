@@ -0,0 +1,41 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "command.h"
+#include "layer.h"
+#include "arena.h"
+#include "depth.h"
+#include "cull.h"
+#include "scene.h"
+
+//Everything recording a frame writes to. Each thread that records frames owns one,
+//so frames can be recorded in parallel
+typedef struct {
+    command_buffer_t commands; //the foreground, drawn over the layers
+    command_buffer_t layer_commands[N_LAYERS];
+    bool layer_used[N_LAYERS]; //recorded into since the last clear
+    command_buffer_t* active; //where draw calls record, commands unless a layer is being recorded
+    arena_t arena; //transient lists, released by arena_reset() at the end of the frame
+    depth_list_t faces; //mesh faces of the frame, painted back to front
+    scene_graph_t scene;
+    cull_stats_t cull_stats;
+    uint64_t project_ticks; //performance counter ticks spent projecting meshes
+    uint32_t random_state;
+} recorder_t;
+
+bool init_recorder(recorder_t* recorder);
+void free_recorder(recorder_t* recorder);
+
+//Drops everything recorded so far, layers included, execution starts by filling clear_color
+void clear_recorder(recorder_t* recorder, uint32_t clear_color);
+
+//Draw calls between these record into the layer instead of the foreground
+void begin_layer(recorder_t* recorder, layer_id_t id);
+void end_layer(recorder_t* recorder);
+
+//Counter hashed per call, so a seed always gives the same numbers whichever thread asks
+void seed_random(recorder_t* recorder, uint32_t seed);
+uint32_t next_random(recorder_t* recorder);
+
+#endif
@@ -0,0 +1,167 @@
+#include "scene.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
+
+transform_t identity_transform(void) {
+    transform_t identity = {
+        .scaling = {.x = 1, .y = 1, .z = 1 },
+        .rotation = {.x = 0, .y = 0, .z = 0 },
+        .translation = {.x = 0, .y = 0, .z = 0 }
+    };
+    return identity;
+}
+
+static bool grow_scene_graph(scene_graph_t* graph, int needed) {
+    if (needed <= graph->capacity) {
+        return true;
+    }
+    int new_capacity = graph->capacity > 0 ? graph->capacity : 64;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+
+    int* parents = (int*)realloc(graph->parents, new_capacity * sizeof(*parents));
+    if (parents) {
+        graph->parents = parents;
+    }
+    transform_t* locals = (transform_t*)realloc(graph->locals, new_capacity * sizeof(*locals));
+    if (locals) {
+        graph->locals = locals;
+    }
+    float* worlds = (float*)realloc(graph->worlds, new_capacity * 12 * sizeof(*worlds));
+    if (worlds) {
+        graph->worlds = worlds;
+    }
+    bool* dirty = (bool*)realloc(graph->dirty, new_capacity * sizeof(*dirty));
+    if (dirty) {
+        graph->dirty = dirty;
+    }
+
+    if (!parents || !locals || !worlds || !dirty) {
+        return false;
+    }
+    graph->capacity = new_capacity;
+    return true;
+}
+
+void free_scene_graph(scene_graph_t* graph) {
+    free(graph->parents);
+    free(graph->locals);
+    free(graph->worlds);
+    free(graph->dirty);
+    scene_graph_t empty = { 0 };
+    *graph = empty;
+}
+
+static void mark_dirty(scene_graph_t* graph, int node) {
+    graph->dirty[node] = true;
+    if (node < graph->first_dirty) {
+        graph->first_dirty = node;
+    }
+}
+
+int add_scene_node(scene_graph_t* graph, int parent, transform_t local) {
+    if (parent >= graph->n_nodes || !grow_scene_graph(graph, graph->n_nodes + 1)) {
+        return -1;
+    }
+
+    //Anything before the new node was clean if first_dirty pointed past the end
+    int node = graph->n_nodes++;
+    graph->parents[node] = parent < 0 ? -1 : parent;
+    graph->locals[node] = local;
+    graph->dirty[node] = false;
+    mark_dirty(graph, node);
+    return node;
+}
+
+void set_node_transform(scene_graph_t* graph, int node, transform_t local) {
+    graph->locals[node] = local;
+    mark_dirty(graph, node);
+}
+
+void set_node_translation(scene_graph_t* graph, int node, vec3_t translation) {
+    graph->locals[node].translation = translation;
+    mark_dirty(graph, node);
+}
+
+//Same rotation order as vec3_rotate_x/y/z applied in turn, with one sin and cos per axis
+static void local_matrix(const transform_t* local, float m[12]) {
+    float sx = sinf(local->rotation.x), cx = cosf(local->rotation.x);
+    float sy = sinf(local->rotation.y), cy = cosf(local->rotation.y);
+    float sz = sinf(local->rotation.z), cz = cosf(local->rotation.z);
+
+    //Rotated basis vectors are the columns
+    float axes[3][3] = { {1, 0, 0}, {0, 1, 0}, {0, 0, 1} };
+    float scales[3] = { local->scaling.x, local->scaling.y, local->scaling.z };
+    for (int i = 0; i < 3; i++) {
+        float x = axes[i][0], y = axes[i][1], z = axes[i][2];
+        float y1 = y * cx - z * sx, z1 = y * sx + z * cx;
+        float x2 = x * cy - z1 * sy, z2 = x * sy + z1 * cy;
+        float x3 = x2 * cz - y1 * sz, y3 = x2 * sz + y1 * cz;
+
+        m[0 + i] = x3 * scales[i];
+        m[4 + i] = y3 * scales[i];
+        m[8 + i] = z2 * scales[i];
+    }
+
+    m[3] = local->translation.x;
+    m[7] = local->translation.y;
+    m[11] = local->translation.z;
+}
+
+//world = parent * local, both affine. Each output row is a sum of local rows weighted by the parent row
+static void compose_affine(const float parent[12], const float local[12], float world[12]) {
+    __m128 row0 = _mm_loadu_ps(local);
+    __m128 row1 = _mm_loadu_ps(local + 4);
+    __m128 row2 = _mm_loadu_ps(local + 8);
+
+    for (int r = 0; r < 3; r++) {
+        const float* p = parent + r * 4;
+        __m128 sum = _mm_mul_ps(_mm_set1_ps(p[0]), row0);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(p[1]), row1));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(p[2]), row2));
+        sum = _mm_add_ps(sum, _mm_set_ps(p[3], 0, 0, 0));
+        _mm_storeu_ps(world + r * 4, sum);
+    }
+}
+
+void update_scene_graph(scene_graph_t* graph) {
+    int updated = 0;
+    for (int i = graph->first_dirty; i < graph->n_nodes; i++) {
+        //A parent recomputed in this pass is still flagged, so the flag carries down its subtree
+        int parent = graph->parents[i];
+        if (!graph->dirty[i] && (parent < 0 || !graph->dirty[parent])) {
+            continue;
+        }
+        graph->dirty[i] = true;
+
+        float* world = graph->worlds + (size_t)i * 12;
+        if (parent < 0) {
+            local_matrix(&graph->locals[i], world);
+        }
+        else {
+            float local[12];
+            local_matrix(&graph->locals[i], local);
+            compose_affine(graph->worlds + (size_t)parent * 12, local, world);
+        }
+        updated++;
+    }
+
+    if (graph->first_dirty < graph->n_nodes) {
+        memset(graph->dirty + graph->first_dirty, 0, (graph->n_nodes - graph->first_dirty) * sizeof(bool));
+    }
+    graph->first_dirty = graph->n_nodes;
+    graph->n_updated = updated;
+}
+
+const float* node_world(const scene_graph_t* graph, int node) {
+    return graph->worlds + (size_t)node * 12;
+}
+
+vec3_t node_position(const scene_graph_t* graph, int node) {
+    const float* m = node_world(graph, node);
+    vec3_t position = {.x = m[3], .y = m[7], .z = m[11] };
+    return position;
+}
@@ -0,0 +1,46 @@
+#ifndef SCENE_H
+#define SCENE_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "vector.h"
+
+//Scaled, rotated around x then y then z, then translated, relative to the parent
+typedef struct {
+    vec3_t scaling;
+    vec3_t rotation;
+    vec3_t translation;
+} transform_t;
+
+//Nodes live in flat arrays in creation order. A parent is always created before its children,
+//so one forward pass reaches every parent before the children that depend on it
+typedef struct {
+    int n_nodes;
+    int capacity;
+    int* parents; //-1 for roots
+    transform_t* locals;
+    float* worlds; //3x4 row-major per node, valid after update_scene_graph
+    bool* dirty; //local changed since the last update
+    int first_dirty; //nothing before it is dirty, n_nodes when clean
+    int n_updated; //world matrices the last update recomputed
+} scene_graph_t;
+
+//Unit scale, no rotation, no translation
+transform_t identity_transform(void);
+
+void free_scene_graph(scene_graph_t* graph);
+
+//Returns the new node, or -1 if the graph could not grow. parent is -1 or an existing node
+int add_scene_node(scene_graph_t* graph, int parent, transform_t local);
+
+//Only marks the node, world matrices follow at the next update
+void set_node_transform(scene_graph_t* graph, int node, transform_t local);
+void set_node_translation(scene_graph_t* graph, int node, vec3_t translation);
+
+//Recomputes the world matrices of dirty nodes and everything below them
+void update_scene_graph(scene_graph_t* graph);
+
+//As of the last update
+const float* node_world(const scene_graph_t* graph, int node);
+vec3_t node_position(const scene_graph_t* graph, int node);
+
+#endif
@@ -1,5 +1,7 @@
 #ifndef TRIANGLE_H
 #define TRIANGLE_H
+#include <stdint.h>
+#include <stdbool.h>
 
 typedef struct {
     int a,
@@ -9,6 +11,12 @@ typedef struct {
 
 typedef struct {
     vec2_t points[3];
+    uint32_t color;
+    int edge_mask; //bit i set when points[i] -> points[(i + 1) % 3] is a mesh edge, not a clipping seam
+    float depth; //average view z of the whole face, larger is farther
+    bool outlined; //depth sorted as its mesh edges in color instead of filled
 }triangle_t;
 
+#define TRIANGLE_ALL_EDGES 7
+
 #endif
\ No newline at end of file